@@ -0,0 +1,82 @@
+#pragma once
+
+// Счётчик выделений памяти для инструментов: заменяет глобальные operator new/delete.
+// Замены - обычные (не inline) функции, поэтому заголовок подключается ровно в один .cpp программы.
+// С transport-catalogue, собранным с TC_TRACK_ALLOCATIONS, не совместим: там свои operator new
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+#define TC_NOINLINE __declspec(noinline)
+#else
+#define TC_NOINLINE __attribute__((noinline))
+#endif
+
+namespace {
+
+    std::atomic<uint64_t> allocations_count{ 0 };
+    std::atomic<uint64_t> allocated_bytes{ 0 };
+
+    // Все замены operator new/delete выделяют и освобождают память только через эту пару функций.
+    // Без встраивания GCC не видит malloc и free внутри operator new/delete у места вызова
+    // и не выдаёт ложного -Wmismatched-new-delete
+    TC_NOINLINE void* CountedAllocate(size_t size) {
+        allocations_count.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    TC_NOINLINE void CountedFree(void* ptr) {
+        std::free(ptr);
+    }
+
+}
+
+void* operator new(size_t size) {
+    if (void* ptr = CountedAllocate(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    if (void* ptr = CountedAllocate(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return CountedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return CountedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    CountedFree(ptr);
+}
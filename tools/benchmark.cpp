@@ -0,0 +1,393 @@
+// Замер всех этапов, которые выполняет main.cpp, на готовых входных документах
+// (например, созданных tools/network_generator.cpp):
+//   json::Load, JsonReader::MakeCatalogue, ParseSettings, построение TransportRouter и TimetableRouter,
+//   каждый запрос из stat_requests по отдельности, json::Print ответа.
+// Для этапа выводятся время, число и объём выделений памяти и пиковый RSS процесса,
+// для каждого типа запросов - пропускная способность и перцентили задержки.
+// Результаты печатаются в JSON (stdout или --output), краткая сводка - в stderr.
+// С --headway дополнительно сравнивается задержка Route между остановками в простой модели
+// (общие bus_wait_time и bus_velocity) и в модели с интервалами и скоростями линий на той же сети.
+//
+// Использование: benchmark [--label TEXT] [--output FILE] [--headway] input1.json [input2.json ...]
+// Пиковый RSS только растёт, поэтому для честного сравнения размеров лучше один документ на запуск.
+
+#include "allocation_counter.h"
+#include "json.h"
+#include "json_builder.h"
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "timetable_router.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+using namespace std::literals;
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    // Пиковый RSS процесса в килобайтах, 0 если платформа его не сообщает
+    uint64_t GetPeakRssKb() {
+#if defined(__APPLE__)
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+#elif defined(__unix__)
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+        return 0;
+#endif
+    }
+
+    struct StageResult {
+        std::string name;
+        double milliseconds = 0.;
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+        uint64_t peak_rss_kb = 0;
+    };
+
+    // Замер одного этапа: время и выделения памяти между созданием и Finish
+    class StageTimer {
+    public:
+        explicit StageTimer(std::string name)
+            : name_(std::move(name))
+            , start_(Clock::now())
+            , allocations_(allocations_count.load())
+            , bytes_(allocated_bytes.load()) {
+        }
+
+        StageResult Finish() const {
+            return { name_, std::chrono::duration<double, std::milli>(Clock::now() - start_).count(),
+                allocations_count.load() - allocations_, allocated_bytes.load() - bytes_, GetPeakRssKb() };
+        }
+
+    private:
+        std::string name_;
+        Clock::time_point start_;
+        uint64_t allocations_;
+        uint64_t bytes_;
+    };
+
+    struct RequestsResult {
+        std::string type;
+        std::vector<double> latencies_us;
+        uint64_t allocations = 0;
+    };
+
+    // Задержки одних и тех же запросов Route в простой модели и в модели с интервалами линий
+    struct HeadwayResult {
+        std::vector<double> simple_us;
+        std::vector<double> headway_us;
+    };
+
+    struct DatasetResult {
+        std::string input;
+        size_t stops_count = 0;
+        size_t buses_count = 0;
+        std::vector<StageResult> stages;
+        std::vector<RequestsResult> requests;
+        std::optional<HeadwayResult> headway;
+    };
+
+    // допустимое замедление модели с интервалами относительно простой
+    constexpr double HEADWAY_MAX_SLOWDOWN = 2.;
+
+    std::string GetRequestType(const json::Dict& request) {
+        std::string type = request.at("type"s).AsString();
+        if (type == "Route"s && request.count("departure_time"s)) {
+            type += "(timetable)"s;
+        }
+        return type;
+    }
+
+    double GetPercentile(const std::vector<double>& sorted, double percentile) {
+        if (sorted.empty()) {
+            return 0.;
+        }
+        const size_t index = static_cast<size_t>(percentile / 100. * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+    // Копия документа, где у всех маршрутов нет собственных интервала и скорости (простая модель)
+    // или они заданы: интервалы от 3 до 30 минут и скорость от 0.7 до 1.3 общей, по кругу
+    json::Document MakeModelDocument(const json::Document& source, bool with_headways) {
+        static const double HEADWAYS[] = { 3., 5., 10., 15., 30. };
+        static const double VELOCITY_FACTORS[] = { 0.7, 1., 1.3 };
+
+        json::Dict root = source.GetRoot().AsMap();
+        const double bus_velocity = root.at("routing_settings"s).AsMap().at("bus_velocity"s).AsDouble();
+        json::Array base_requests = root.at("base_requests"s).AsArray();
+        size_t bus_index = 0;
+        for (json::Node& request : base_requests) {
+            if (request.AsMap().at("type"s).AsString() != "Bus"s) {
+                continue;
+            }
+            json::Dict bus = request.AsMap();
+            bus.erase("headway"s);
+            bus.erase("velocity"s);
+            if (with_headways) {
+                bus["headway"s] = HEADWAYS[bus_index % std::size(HEADWAYS)];
+                bus["velocity"s] = bus_velocity * VELOCITY_FACTORS[bus_index % std::size(VELOCITY_FACTORS)];
+            }
+            ++bus_index;
+            request = json::Node{ std::move(bus) };
+        }
+        root["base_requests"s] = json::Node{ std::move(base_requests) };
+        return json::Document{ json::Node{ std::move(root) } };
+    }
+
+    // Задержка FindRoute для запросов Route между остановками; кэш маршрутов отключён,
+    // чтобы мерить поиск. Каждый запрос сначала выполняется для прогрева
+    std::vector<double> MeasureStopRoutes(const json::Document& document, const json::Array& stat_requests) {
+        const JsonReader json_reader(json::Document{ document.GetRoot() });
+        catalogue::TransportCatalogue catalogue;
+        json_reader.MakeCatalogue(catalogue);
+        RouteSettings route_settings = json_reader.GetRouteSettings();
+        route_settings.route_cache_size = 0;
+        const TransportRouter router(catalogue, route_settings);
+
+        std::vector<double> latencies_us;
+        for (const json::Node& request : stat_requests) {
+            const json::Dict& request_map = request.AsMap();
+            if (GetRequestType(request_map) != "Route"s || !request_map.at("from"s).IsString() || !request_map.at("to"s).IsString()
+                || catalogue.GetStop(request_map.at("from"s).AsString()) == nullptr || catalogue.GetStop(request_map.at("to"s).AsString()) == nullptr) {
+                continue;
+            }
+            router.FindRoute(request_map.at("from"s).AsString(), request_map.at("to"s).AsString());
+            const Clock::time_point start = Clock::now();
+            router.FindRoute(request_map.at("from"s).AsString(), request_map.at("to"s).AsString());
+            latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+        std::sort(latencies_us.begin(), latencies_us.end());
+        return latencies_us;
+    }
+
+    HeadwayResult RunHeadwayComparison(const json::Document& document, const json::Array& stat_requests) {
+        HeadwayResult result;
+        result.simple_us = MeasureStopRoutes(MakeModelDocument(document, false), stat_requests);
+        result.headway_us = MeasureStopRoutes(MakeModelDocument(document, true), stat_requests);
+        return result;
+    }
+
+    DatasetResult RunDataset(const std::string& input, bool compare_headways) {
+        DatasetResult result;
+        result.input = input;
+
+        // файл читается заранее, чтобы json::Load мерил разбор, а не диск
+        std::ifstream file(input, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Can't open "s + input);
+        }
+        std::stringstream text;
+        text << file.rdbuf();
+
+        StageTimer load_timer("json::Load"s);
+        json::Document document = json::Load(text);
+        result.stages.push_back(load_timer.Finish());
+
+        const json::Array stat_requests = document.GetRoot().AsMap().at("stat_requests"s).AsArray();
+        std::optional<json::Document> headway_source;
+        if (compare_headways) {
+            headway_source = document;
+        }
+        const JsonReader json_reader(std::move(document));
+
+        catalogue::TransportCatalogue catalogue;
+        StageTimer catalogue_timer("JsonReader::MakeCatalogue"s);
+        json_reader.MakeCatalogue(catalogue);
+        result.stages.push_back(catalogue_timer.Finish());
+        result.stops_count = catalogue.GetStops()->size();
+        result.buses_count = catalogue.GetBuses()->size();
+
+        StageTimer settings_timer("ParseSettings"s);
+        const MapRenderer renderer(json_reader.ParseSettings());
+        result.stages.push_back(settings_timer.Finish());
+
+        StageTimer router_timer("TransportRouter"s);
+        const RouteSettings route_settings = json_reader.GetRouteSettings();
+        const TransportRouter transport_router(catalogue, route_settings);
+        result.stages.push_back(router_timer.Finish());
+
+        StageTimer timetable_timer("TimetableRouter"s);
+        const TimetableRouter timetable_router(catalogue, route_settings);
+        result.stages.push_back(timetable_timer.Finish());
+
+        std::map<std::string, RequestsResult> requests;
+        std::vector<json::Node> responses;
+        StageTimer requests_timer("stat_requests"s);
+        for (const json::Node& request : stat_requests) {
+            const json::Dict& request_map = request.AsMap();
+            const uint64_t allocations_before = allocations_count.load();
+            const Clock::time_point start = Clock::now();
+            std::optional<json::Node> response = json_reader.ProcessRequest(request_map, catalogue, renderer, transport_router, timetable_router);
+            const double latency = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+            RequestsResult& stats = requests[GetRequestType(request_map)];
+            stats.latencies_us.push_back(latency);
+            stats.allocations += allocations_count.load() - allocations_before;
+            if (response) {
+                responses.push_back(std::move(*response));
+            }
+        }
+        result.stages.push_back(requests_timer.Finish());
+
+        std::ostringstream out;
+        StageTimer print_timer("json::Print"s);
+        json::Print(json::Document{ json::Node{ std::move(responses) } }, out);
+        result.stages.push_back(print_timer.Finish());
+
+        for (auto& [type, stats] : requests) {
+            stats.type = type;
+            std::sort(stats.latencies_us.begin(), stats.latencies_us.end());
+            result.requests.push_back(std::move(stats));
+        }
+
+        if (headway_source) {
+            result.headway = RunHeadwayComparison(*headway_source, stat_requests);
+        }
+        return result;
+    }
+
+    json::Node MakeDatasetNode(const DatasetResult& dataset) {
+        json::Array stages;
+        for (const StageResult& stage : dataset.stages) {
+            stages.push_back(json::Builder{}.StartDict().
+                Key("name"s).Value(stage.name).
+                Key("ms"s).Value(stage.milliseconds).
+                Key("allocations"s).Value(static_cast<double>(stage.allocations)).
+                Key("allocated_bytes"s).Value(static_cast<double>(stage.bytes)).
+                Key("peak_rss_kb"s).Value(static_cast<double>(stage.peak_rss_kb)).
+                EndDict().Build());
+        }
+
+        json::Array requests;
+        for (const RequestsResult& stats : dataset.requests) {
+            double total_us = 0.;
+            for (double latency : stats.latencies_us) {
+                total_us += latency;
+            }
+            requests.push_back(json::Builder{}.StartDict().
+                Key("type"s).Value(stats.type).
+                Key("count"s).Value(static_cast<int>(stats.latencies_us.size())).
+                Key("throughput_per_s"s).Value(total_us > 0. ? stats.latencies_us.size() * 1e6 / total_us : 0.).
+                Key("p50_us"s).Value(GetPercentile(stats.latencies_us, 50.)).
+                Key("p90_us"s).Value(GetPercentile(stats.latencies_us, 90.)).
+                Key("p99_us"s).Value(GetPercentile(stats.latencies_us, 99.)).
+                Key("max_us"s).Value(stats.latencies_us.empty() ? 0. : stats.latencies_us.back()).
+                Key("allocations_per_request"s).Value(stats.latencies_us.empty() ? 0. : static_cast<double>(stats.allocations) / stats.latencies_us.size()).
+                EndDict().Build());
+        }
+
+        json::Builder result;
+        result.StartDict().
+            Key("input"s).Value(dataset.input).
+            Key("stops"s).Value(static_cast<int>(dataset.stops_count)).
+            Key("buses"s).Value(static_cast<int>(dataset.buses_count)).
+            Key("stages"s).Value(stages).
+            Key("requests"s).Value(requests);
+        if (dataset.headway) {
+            const HeadwayResult& headway = *dataset.headway;
+            const double simple_p50 = GetPercentile(headway.simple_us, 50.);
+            const double headway_p50 = GetPercentile(headway.headway_us, 50.);
+            const double simple_p99 = GetPercentile(headway.simple_us, 99.);
+            const double headway_p99 = GetPercentile(headway.headway_us, 99.);
+            result.Key("headway_model"s).StartDict().
+                Key("routes"s).Value(static_cast<int>(headway.simple_us.size())).
+                Key("simple_p50_us"s).Value(simple_p50).
+                Key("headway_p50_us"s).Value(headway_p50).
+                Key("simple_p99_us"s).Value(simple_p99).
+                Key("headway_p99_us"s).Value(headway_p99).
+                Key("slowdown_p50"s).Value(simple_p50 > 0. ? headway_p50 / simple_p50 : 0.).
+                Key("slowdown_p99"s).Value(simple_p99 > 0. ? headway_p99 / simple_p99 : 0.).
+                Key("within_limit"s).Value(headway_p50 <= HEADWAY_MAX_SLOWDOWN * simple_p50 && headway_p99 <= HEADWAY_MAX_SLOWDOWN * simple_p99).
+                EndDict();
+        }
+        return result.EndDict().Build();
+    }
+
+    void PrintSummary(const DatasetResult& dataset, std::ostream& out) {
+        out << dataset.input << ": " << dataset.stops_count << " stops, " << dataset.buses_count << " buses\n";
+        for (const StageResult& stage : dataset.stages) {
+            out << "  " << stage.name << ": " << stage.milliseconds << " ms, " << stage.allocations << " allocations, "
+                << stage.bytes / 1024 << " KB allocated, peak RSS " << stage.peak_rss_kb << " KB\n";
+        }
+        for (const RequestsResult& stats : dataset.requests) {
+            out << "  " << stats.type << " x" << stats.latencies_us.size() << ": p50 " << GetPercentile(stats.latencies_us, 50.)
+                << " us, p99 " << GetPercentile(stats.latencies_us, 99.) << " us, max "
+                << (stats.latencies_us.empty() ? 0. : stats.latencies_us.back()) << " us\n";
+        }
+        if (dataset.headway) {
+            out << "  Route headway model x" << dataset.headway->headway_us.size() << ": p50 " << GetPercentile(dataset.headway->headway_us, 50.)
+                << " us (simple " << GetPercentile(dataset.headway->simple_us, 50.) << " us), p99 " << GetPercentile(dataset.headway->headway_us, 99.)
+                << " us (simple " << GetPercentile(dataset.headway->simple_us, 99.) << " us)\n";
+        }
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string label;
+    std::string output;
+    std::vector<std::string> inputs;
+    bool compare_headways = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--headway"s) {
+            compare_headways = true;
+        }
+        else if ((argument == "--label"s || argument == "--output"s) && i + 1 < argc) {
+            (argument == "--label"s ? label : output) = argv[++i];
+        }
+        else {
+            inputs.push_back(argument);
+        }
+    }
+    if (inputs.empty()) {
+        std::cerr << "Usage: benchmark [--label TEXT] [--output FILE] [--headway] input1.json [input2.json ...]" << std::endl;
+        return 1;
+    }
+
+    try {
+        json::Array datasets;
+        for (const std::string& input : inputs) {
+            const DatasetResult dataset = RunDataset(input, compare_headways);
+            PrintSummary(dataset, std::cerr);
+            datasets.push_back(MakeDatasetNode(dataset));
+        }
+
+        const json::Document results{ json::Builder{}.StartDict().
+            Key("label"s).Value(label).
+            Key("datasets"s).Value(datasets).
+            EndDict().Build() };
+        if (output.empty()) {
+            json::Print(results, std::cout);
+        }
+        else {
+            std::ofstream out(output);
+            json::Print(results, out);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,450 @@
+// Генератор синтетической транспортной сети для нагрузочных проверок справочника.
+// Выводит полный входной документ: base_requests, render_settings, routing_settings и stat_requests.
+// Один и тот же seed даёт побайтно одинаковый результат на любой платформе.
+//
+// Параметры (все необязательные):
+//   --stops N            число остановок (1000)
+//   --lines N            число маршрутов (100)
+//   --line-length N      число остановок в маршруте (20)
+//   --roundtrip-ratio X  доля кольцевых маршрутов (0.3)
+//   --queries N          число запросов (1000)
+//   --mix B,S,R,M        веса запросов Bus, Stop, Route, Map (4,4,2,0)
+//   --seed N             зерно генератора (1)
+//   --output FILE        файл для вывода, по умолчанию stdout
+
+#include "geo.h"
+#include "json.h"
+#include "json_builder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+    const double PI = 3.1415926535;
+    const double KM_PER_DEGREE = 111.32;
+    // площадь на одну остановку, кв. км: в среднем около 300 м между соседними остановками
+    const double AREA_PER_STOP = 0.09;
+    const size_t STOPS_PER_DISTRICT = 500;
+    // сколько ближайших остановок рассматривается на каждом шаге маршрута
+    const size_t NEIGHBOURS_COUNT = 8;
+
+    struct GeneratorSettings {
+        size_t stops_count = 1000;
+        size_t lines_count = 100;
+        size_t line_length = 20;
+        double roundtrip_ratio = 0.3;
+        size_t queries_count = 1000;
+        std::vector<double> query_mix{ 4., 4., 2., 0. };
+        uint64_t seed = 1;
+        std::string output;
+    };
+
+    // Распределения стандартной библиотеки зависят от реализации, поэтому равномерные
+    // и нормальные величины строятся прямо из потока mt19937_64, который везде одинаков
+    class Random {
+    public:
+        explicit Random(uint64_t seed)
+            : engine_(seed) {
+        }
+
+        // [0, 1)
+        double Uniform() {
+            return static_cast<double>(engine_() >> 11) * (1. / 9007199254740992.);
+        }
+
+        double Uniform(double from, double to) {
+            return from + (to - from) * Uniform();
+        }
+
+        // [0, count)
+        size_t Index(size_t count) {
+            return static_cast<size_t>(Uniform() * static_cast<double>(count));
+        }
+
+        // Box-Muller
+        double Normal() {
+            const double u = 1. - Uniform();
+            return std::sqrt(-2. * std::log(u)) * std::cos(2. * PI * Uniform());
+        }
+
+    private:
+        std::mt19937_64 engine_;
+    };
+
+    struct GeneratedStop {
+        std::string name;
+        catalogue::detail::Coordinates coordinates;
+        // смещение от центра города в километрах, для поиска соседей
+        double x = 0.;
+        double y = 0.;
+    };
+
+    struct GeneratedLine {
+        std::string name;
+        std::vector<size_t> stops;
+        bool is_roundtrip = false;
+    };
+
+    // Равномерная сетка по плоским координатам остановок
+    class NeighbourGrid {
+    public:
+        NeighbourGrid(const std::vector<GeneratedStop>& stops, double cell_size)
+            : stops_(stops)
+            , cell_size_(cell_size) {
+            min_x_ = min_y_ = 0.;
+            double max_x = 0., max_y = 0.;
+            for (const GeneratedStop& stop : stops) {
+                min_x_ = std::min(min_x_, stop.x);
+                min_y_ = std::min(min_y_, stop.y);
+                max_x = std::max(max_x, stop.x);
+                max_y = std::max(max_y, stop.y);
+            }
+            cols_ = static_cast<size_t>((max_x - min_x_) / cell_size_) + 1;
+            rows_ = static_cast<size_t>((max_y - min_y_) / cell_size_) + 1;
+            cells_.resize(cols_ * rows_);
+            for (size_t i = 0; i < stops.size(); ++i) {
+                cells_[GetRow(stops[i].y) * cols_ + GetCol(stops[i].x)].push_back(i);
+            }
+        }
+
+        // До count ближайших к остановке других остановок
+        std::vector<size_t> FindNearest(size_t stop, size_t count) const {
+            std::vector<std::pair<double, size_t>> found;
+            const size_t row = GetRow(stops_[stop].y);
+            const size_t col = GetCol(stops_[stop].x);
+            for (size_t radius = 1; found.size() < count && (radius <= rows_ || radius <= cols_); ++radius) {
+                found.clear();
+                for (size_t r = row > radius ? row - radius : 0; r <= std::min(row + radius, rows_ - 1); ++r) {
+                    for (size_t c = col > radius ? col - radius : 0; c <= std::min(col + radius, cols_ - 1); ++c) {
+                        for (size_t other : cells_[r * cols_ + c]) {
+                            if (other != stop) {
+                                found.emplace_back(std::hypot(stops_[other].x - stops_[stop].x, stops_[other].y - stops_[stop].y), other);
+                            }
+                        }
+                    }
+                }
+            }
+            std::sort(found.begin(), found.end());
+            std::vector<size_t> result;
+            for (size_t i = 0; i < found.size() && i < count; ++i) {
+                result.push_back(found[i].second);
+            }
+            return result;
+        }
+
+    private:
+        size_t GetCol(double x) const {
+            return std::min(static_cast<size_t>((x - min_x_) / cell_size_), cols_ - 1);
+        }
+        size_t GetRow(double y) const {
+            return std::min(static_cast<size_t>((y - min_y_) / cell_size_), rows_ - 1);
+        }
+
+        const std::vector<GeneratedStop>& stops_;
+        double cell_size_;
+        double min_x_;
+        double min_y_;
+        size_t cols_ = 1;
+        size_t rows_ = 1;
+        std::vector<std::vector<size_t>> cells_;
+    };
+
+    // Остановки группируются в районы, районы гуще к центру города
+    std::vector<GeneratedStop> GenerateStops(const GeneratorSettings& settings, Random& random) {
+        const catalogue::detail::Coordinates center{ 55.75, 37.62 };
+        const double city_radius = std::sqrt(settings.stops_count * AREA_PER_STOP / PI);
+        const size_t districts_count = std::max<size_t>(1, settings.stops_count / STOPS_PER_DISTRICT);
+        const double district_radius = city_radius / std::sqrt(static_cast<double>(districts_count));
+
+        std::vector<std::pair<double, double>> districts;
+        for (size_t i = 0; i < districts_count; ++i) {
+            const double radius = city_radius * std::pow(random.Uniform(), 0.75);
+            const double angle = random.Uniform(0., 2. * PI);
+            districts.emplace_back(radius * std::cos(angle), radius * std::sin(angle));
+        }
+
+        const std::vector<std::string_view> streets{ "Sadovaya"sv, "Lesnaya"sv, "Tsentralnaya"sv, "Shkolnaya"sv, "Rechnaya"sv,
+            "Polevaya"sv, "Vokzalnaya"sv, "Zavodskaya"sv, "Mira"sv, "Parkovaya"sv, "Lugovaya"sv, "Sovetskaya"sv };
+        const std::vector<std::string_view> kinds{ "ulitsa"sv, "ploshchad"sv, "prospekt"sv, "bulvar"sv, "pereulok"sv };
+
+        std::vector<GeneratedStop> stops;
+        for (size_t i = 0; i < settings.stops_count; ++i) {
+            const auto [district_x, district_y] = districts[random.Index(districts.size())];
+            GeneratedStop stop;
+            stop.x = district_x + random.Normal() * district_radius * 0.5;
+            stop.y = district_y + random.Normal() * district_radius * 0.5;
+            stop.coordinates.lat = center.lat + stop.y / KM_PER_DEGREE;
+            stop.coordinates.lng = center.lng + stop.x / (KM_PER_DEGREE * std::cos(center.lat * PI / 180.));
+            // номер в названии делает его уникальным
+            stop.name = std::string(streets[random.Index(streets.size())]) + ' ' + std::string(kinds[random.Index(kinds.size())])
+                + ' ' + std::to_string(i + 1);
+            stops.push_back(std::move(stop));
+        }
+        return stops;
+    }
+
+    // Маршрут - случайное блуждание по ближайшим остановкам с сохранением направления.
+    // Кольцевой маршрут плавно поворачивает и замыкается на первую остановку
+    std::vector<GeneratedLine> GenerateLines(const GeneratorSettings& settings, const std::vector<GeneratedStop>& stops, Random& random) {
+        std::vector<GeneratedLine> lines;
+        if (stops.size() < 2) {
+            return lines;
+        }
+        const NeighbourGrid grid(stops, std::sqrt(AREA_PER_STOP) * 2.);
+
+        for (size_t i = 0; i < settings.lines_count; ++i) {
+            GeneratedLine line;
+            line.name = std::to_string(i + 1);
+            line.is_roundtrip = random.Uniform() < settings.roundtrip_ratio;
+
+            double heading = random.Uniform(0., 2. * PI);
+            const double turn = line.is_roundtrip ? 2. * PI / static_cast<double>(std::max<size_t>(settings.line_length, 3)) : 0.;
+            size_t current = random.Index(stops.size());
+            line.stops.push_back(current);
+
+            while (line.stops.size() < settings.line_length) {
+                heading += turn + random.Normal() * 0.3;
+                size_t best = stops.size();
+                double best_score = 0.;
+                for (size_t next : grid.FindNearest(current, NEIGHBOURS_COUNT)) {
+                    if (std::find(line.stops.begin(), line.stops.end(), next) != line.stops.end()) {
+                        continue;
+                    }
+                    const double dx = stops[next].x - stops[current].x;
+                    const double dy = stops[next].y - stops[current].y;
+                    const double score = (dx * std::cos(heading) + dy * std::sin(heading)) / std::max(std::hypot(dx, dy), 1e-9);
+                    if (best == stops.size() || score > best_score) {
+                        best = next;
+                        best_score = score;
+                    }
+                }
+                if (best == stops.size()) {
+                    break;
+                }
+                current = best;
+                line.stops.push_back(current);
+            }
+            if (line.is_roundtrip) {
+                line.stops.push_back(line.stops.front());
+            }
+            lines.push_back(std::move(line));
+        }
+        return lines;
+    }
+
+    // Дорожные расстояния между соседними остановками маршрутов: не короче расстояния по прямой
+    // (ComputeDistance), с коэффициентом извилистости, иногда разные в разных направлениях
+    std::vector<json::Dict> GenerateDistances(const std::vector<GeneratedStop>& stops, const std::vector<GeneratedLine>& lines, Random& random) {
+        std::vector<json::Dict> distances(stops.size());
+        const auto add_distance = [&](size_t from, size_t to) {
+            if (from == to || distances[from].count(stops[to].name)) {
+                return;
+            }
+            const double geo_distance = catalogue::detail::ComputeDistance(stops[from].coordinates, stops[to].coordinates);
+            const int road_distance = static_cast<int>(std::ceil(geo_distance * random.Uniform(1.05, 1.5))) + 1;
+            distances[from][stops[to].name] = road_distance;
+            if (random.Uniform() < 0.2 && !distances[to].count(stops[from].name)) {
+                distances[to][stops[from].name] = static_cast<int>(road_distance * random.Uniform(1., 1.2));
+            }
+        };
+
+        for (const GeneratedLine& line : lines) {
+            for (size_t i = 0; i + 1 < line.stops.size(); ++i) {
+                add_distance(line.stops[i], line.stops[i + 1]);
+            }
+        }
+        return distances;
+    }
+
+    json::Node MakeRenderSettings() {
+        return json::Builder{}.StartDict().
+            Key("width"s).Value(1200.).
+            Key("height"s).Value(1200.).
+            Key("padding"s).Value(50.).
+            Key("line_width"s).Value(4.).
+            Key("stop_radius"s).Value(3.).
+            Key("bus_label_font_size"s).Value(14).
+            Key("bus_label_offset"s).StartArray().Value(7.).Value(15.).EndArray().
+            Key("stop_label_font_size"s).Value(10).
+            Key("stop_label_offset"s).StartArray().Value(7.).Value(-3.).EndArray().
+            Key("underlayer_color"s).StartArray().Value(255).Value(255).Value(255).Value(0.85).EndArray().
+            Key("underlayer_width"s).Value(3.).
+            Key("color_palette"s).StartArray().
+                Value("green"s).Value("red"s).Value("blue"s).Value("orange"s).
+                StartArray().Value(255).Value(160).Value(0).EndArray().
+                StartArray().Value(120).Value(40).Value(200).EndArray().
+            EndArray().
+            EndDict().Build();
+    }
+
+    std::vector<json::Node> GenerateQueries(const GeneratorSettings& settings, const std::vector<GeneratedStop>& stops,
+        const std::vector<GeneratedLine>& lines, Random& random) {
+        double total_weight = 0.;
+        for (double weight : settings.query_mix) {
+            total_weight += weight;
+        }
+
+        std::vector<json::Node> queries;
+        for (size_t id = 1; id <= settings.queries_count && total_weight > 0.; ++id) {
+            double choice = random.Uniform(0., total_weight);
+            size_t type = 0;
+            while (type + 1 < settings.query_mix.size() && choice >= settings.query_mix[type]) {
+                choice -= settings.query_mix[type];
+                ++type;
+            }
+
+            json::Builder query;
+            query.StartDict().Key("id"s).Value(static_cast<int>(id));
+            // небольшая доля запросов к несуществующим объектам проверяет ответы "not found"
+            const bool missing = random.Uniform() < 0.01;
+            if (type == 0 && !lines.empty()) {
+                query.Key("type"s).Value("Bus"s).
+                    Key("name"s).Value(missing ? "no such bus"s : lines[random.Index(lines.size())].name);
+            }
+            else if (type == 1 || (type == 0 && lines.empty())) {
+                query.Key("type"s).Value("Stop"s).
+                    Key("name"s).Value(missing ? "no such stop"s : stops[random.Index(stops.size())].name);
+            }
+            else if (type == 2) {
+                query.Key("type"s).Value("Route"s).
+                    Key("from"s).Value(stops[random.Index(stops.size())].name).
+                    Key("to"s).Value(stops[random.Index(stops.size())].name);
+            }
+            else {
+                query.Key("type"s).Value("Map"s);
+            }
+            queries.push_back(query.EndDict().Build());
+        }
+        return queries;
+    }
+
+    json::Document MakeDocument(const GeneratorSettings& settings) {
+        Random random(settings.seed);
+        const std::vector<GeneratedStop> stops = GenerateStops(settings, random);
+        const std::vector<GeneratedLine> lines = GenerateLines(settings, stops, random);
+        const std::vector<json::Dict> distances = GenerateDistances(stops, lines, random);
+
+        json::Array base_requests;
+        for (size_t i = 0; i < stops.size(); ++i) {
+            base_requests.push_back(json::Builder{}.StartDict().
+                Key("type"s).Value("Stop"s).
+                Key("name"s).Value(stops[i].name).
+                Key("latitude"s).Value(stops[i].coordinates.lat).
+                Key("longitude"s).Value(stops[i].coordinates.lng).
+                Key("road_distances"s).Value(distances[i]).
+                EndDict().Build());
+        }
+        for (const GeneratedLine& line : lines) {
+            json::Array line_stops;
+            // у некольцевого маршрута во входных данных только прямое направление
+            for (size_t stop : line.stops) {
+                line_stops.push_back(json::Node{ stops[stop].name });
+            }
+            base_requests.push_back(json::Builder{}.StartDict().
+                Key("type"s).Value("Bus"s).
+                Key("name"s).Value(line.name).
+                Key("stops"s).Value(line_stops).
+                Key("is_roundtrip"s).Value(line.is_roundtrip).
+                EndDict().Build());
+        }
+
+        return json::Document{ json::Builder{}.StartDict().
+            Key("base_requests"s).Value(base_requests).
+            Key("render_settings"s).Value(MakeRenderSettings().AsMap()).
+            Key("routing_settings"s).StartDict().
+                Key("bus_wait_time"s).Value(6).
+                Key("bus_velocity"s).Value(40).
+            EndDict().
+            Key("stat_requests"s).Value(GenerateQueries(settings, stops, lines, random)).
+            EndDict().Build() };
+    }
+
+    std::vector<double> ParseMix(const std::string& text) {
+        std::vector<double> mix;
+        size_t begin = 0;
+        while (begin <= text.size()) {
+            const size_t end = std::min(text.find(',', begin), text.size());
+            mix.push_back(std::stod(text.substr(begin, end - begin)));
+            begin = end + 1;
+        }
+        if (mix.size() != 4) {
+            throw std::invalid_argument("--mix expects four weights: Bus,Stop,Route,Map"s);
+        }
+        return mix;
+    }
+
+    GeneratorSettings ParseArguments(int argc, char* argv[]) {
+        GeneratorSettings settings;
+        for (int i = 1; i < argc; i += 2) {
+            const std::string_view key = argv[i];
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for "s + std::string(key));
+            }
+            const std::string value = argv[i + 1];
+            if (key == "--stops"sv) {
+                settings.stops_count = std::stoul(value);
+            }
+            else if (key == "--lines"sv) {
+                settings.lines_count = std::stoul(value);
+            }
+            else if (key == "--line-length"sv) {
+                settings.line_length = std::max<size_t>(std::stoul(value), 2);
+            }
+            else if (key == "--roundtrip-ratio"sv) {
+                settings.roundtrip_ratio = std::stod(value);
+            }
+            else if (key == "--queries"sv) {
+                settings.queries_count = std::stoul(value);
+            }
+            else if (key == "--mix"sv) {
+                settings.query_mix = ParseMix(value);
+            }
+            else if (key == "--seed"sv) {
+                settings.seed = std::stoull(value);
+            }
+            else if (key == "--output"sv) {
+                settings.output = value;
+            }
+            else {
+                throw std::invalid_argument("Unknown argument "s + std::string(key));
+            }
+        }
+        if (settings.stops_count < 2) {
+            throw std::invalid_argument("At least two stops are required"s);
+        }
+        return settings;
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const GeneratorSettings settings = ParseArguments(argc, argv);
+        const json::Document document = MakeDocument(settings);
+
+        std::ofstream file;
+        if (!settings.output.empty()) {
+            file.open(settings.output);
+        }
+        std::ostream& out = settings.output.empty() ? std::cout : file;
+        // координатам нужно больше 6 значащих цифр по умолчанию
+        out.precision(10);
+        json::Print(document, out);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
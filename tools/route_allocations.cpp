@@ -0,0 +1,99 @@
+// Проверка, что поиск маршрута между остановками после прогрева не выделяет память:
+// рёбра пути и элементы маршрута пишутся в переиспользуемые буферы QueryWorkspace и потока.
+// Берёт запросы Route между остановками из stat_requests документа (или пары соседних остановок),
+// выполняет каждый TransportRouter::FindRoute один раз для прогрева и ещё раз со счётом operator new.
+// Кэш маршрутов отключается: проверяется сам поиск, а не копирование готового ответа.
+//
+// Использование: route_allocations input.json
+// Код возврата 0 - выделений нет, 1 - есть (печатаются первые такие запросы), 2 - ошибка входа.
+
+#include "allocation_counter.h"
+#include "json.h"
+#include "json_reader.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+    // Пары остановок из запросов Route; если их нет - соседние остановки справочника
+    std::vector<std::pair<std::string_view, std::string_view>> GetRoutePairs(const json::Array& stat_requests,
+        const catalogue::TransportCatalogue& catalogue) {
+        std::vector<std::pair<std::string_view, std::string_view>> pairs;
+        for (const json::Node& request : stat_requests) {
+            const json::Dict& request_map = request.AsMap();
+            if (request_map.at("type"s).AsString() != "Route"s || request_map.count("departure_time"s)
+                || !request_map.at("from"s).IsString() || !request_map.at("to"s).IsString()) {
+                continue;
+            }
+            const std::string& from = request_map.at("from"s).AsString();
+            const std::string& to = request_map.at("to"s).AsString();
+            if (catalogue.GetStop(from) != nullptr && catalogue.GetStop(to) != nullptr) {
+                pairs.emplace_back(catalogue.GetStop(from)->stop_name, catalogue.GetStop(to)->stop_name);
+            }
+        }
+        if (pairs.empty()) {
+            const Stop* previous = nullptr;
+            for (const Stop& stop : *catalogue.GetStops()) {
+                if (previous != nullptr) {
+                    pairs.emplace_back(previous->stop_name, stop.stop_name);
+                }
+                previous = &stop;
+            }
+        }
+        return pairs;
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: route_allocations input.json" << std::endl;
+        return 2;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file) {
+        std::cerr << "Can't open " << argv[1] << std::endl;
+        return 2;
+    }
+    json::Document document = json::Load(file);
+    const json::Array stat_requests = document.GetRoot().AsMap().at("stat_requests"s).AsArray();
+    const JsonReader json_reader(std::move(document));
+
+    catalogue::TransportCatalogue catalogue;
+    json_reader.MakeCatalogue(catalogue);
+    RouteSettings route_settings = json_reader.GetRouteSettings();
+    route_settings.route_cache_size = 0;
+    const TransportRouter router(catalogue, route_settings);
+
+    const std::vector<std::pair<std::string_view, std::string_view>> pairs = GetRoutePairs(stat_requests, catalogue);
+    for (const auto& [from, to] : pairs) {
+        router.FindRoute(from, to);
+    }
+
+    size_t found_count = 0;
+    size_t failed_count = 0;
+    uint64_t allocations = 0;
+    for (const auto& [from, to] : pairs) {
+        const uint64_t route_allocations_before = allocations_count.load();
+        found_count += router.FindRoute(from, to).has_value();
+        const uint64_t route_allocations = allocations_count.load() - route_allocations_before;
+        allocations += route_allocations;
+        // вывод сам может выделять память, поэтому считаются только вызовы FindRoute
+        if (route_allocations > 0 && ++failed_count <= 10) {
+            std::cerr << "FindRoute(" << from << ", " << to << "): " << route_allocations << " allocations" << std::endl;
+        }
+    }
+
+    std::cout << pairs.size() << " routes (" << found_count << " found): " << allocations << " allocations after warm-up" << std::endl;
+    return allocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+#include "arena.h"
+
+#include <cstdint>
+
+using namespace catalogue;
+
+std::string_view Arena::CopyString(std::string_view text) {
+	const ranges::Range<const char*> copy = CopyArray(text.data(), text.size());
+	return { copy.begin(), text.size() };
+}
+
+size_t Arena::MemoryUsage() const {
+	return blocks_bytes_ + blocks_.capacity() * sizeof(std::unique_ptr<char[]>);
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+	const size_t padding = (alignment - reinterpret_cast<uintptr_t>(current_) % alignment) % alignment;
+	if (current_ != nullptr && padding + size <= current_left_) {
+		char* result = current_ + padding;
+		current_ = result + size;
+		current_left_ -= padding + size;
+		return result;
+	}
+
+	// большие участки получают отдельный блок, чтобы не бросать недоиспользованным текущий
+	const size_t block_size = size + alignment > BLOCK_SIZE / 4 ? size + alignment : BLOCK_SIZE;
+	blocks_.emplace_back(new char[block_size]);
+	blocks_bytes_ += block_size;
+	char* block = blocks_.back().get();
+	char* result = block + (alignment - reinterpret_cast<uintptr_t>(block) % alignment) % alignment;
+	if (block_size == BLOCK_SIZE) {
+		current_ = result + size;
+		current_left_ = block + block_size - current_;
+	}
+	return result;
+}
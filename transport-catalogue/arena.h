@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ranges.h"
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace catalogue {
+
+	// Монотонная арена: участки выдаются подряд из крупных блоков и освобождаются только вместе с ареной.
+	// Блоки не перемещаются, поэтому выданные указатели действительны всё время жизни арены
+	class Arena {
+	public:
+		static constexpr size_t BLOCK_SIZE = 1 << 16;
+
+		Arena() = default;
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		std::string_view CopyString(std::string_view text);
+
+		// Копия массива тривиально копируемых объектов
+		template <typename T>
+		ranges::Range<const T*> CopyArray(const T* data, size_t count) {
+			static_assert(std::is_trivially_copyable_v<T>, "Arena stores only trivially copyable objects");
+			T* copy = static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+			if (count > 0) {
+				std::memcpy(copy, data, count * sizeof(T));
+			}
+			return { copy, copy + count };
+		}
+
+		// Память всех блоков, включая незанятые хвосты
+		size_t MemoryUsage() const;
+
+	private:
+		void* Allocate(size_t size, size_t alignment);
+
+		std::vector<std::unique_ptr<char[]>> blocks_;
+		char* current_ = nullptr;
+		size_t current_left_ = 0;
+		size_t blocks_bytes_ = 0;
+	};
+}
@@ -0,0 +1,33 @@
+#include "base64.h"
+
+#include <cstdint>
+
+namespace {
+    const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+}
+
+std::string EncodeBase64(std::string_view data) {
+    std::string result;
+    result.reserve((data.size() + 2) / 3 * 4);
+
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        const uint32_t triple = static_cast<unsigned char>(data[i]) << 16 | static_cast<unsigned char>(data[i + 1]) << 8
+            | static_cast<unsigned char>(data[i + 2]);
+        result += BASE64_ALPHABET[triple >> 18 & 0x3F];
+        result += BASE64_ALPHABET[triple >> 12 & 0x3F];
+        result += BASE64_ALPHABET[triple >> 6 & 0x3F];
+        result += BASE64_ALPHABET[triple & 0x3F];
+    }
+    if (i < data.size()) {
+        uint32_t triple = static_cast<unsigned char>(data[i]) << 16;
+        if (i + 1 < data.size()) {
+            triple |= static_cast<unsigned char>(data[i + 1]) << 8;
+        }
+        result += BASE64_ALPHABET[triple >> 18 & 0x3F];
+        result += BASE64_ALPHABET[triple >> 12 & 0x3F];
+        result += i + 1 < data.size() ? BASE64_ALPHABET[triple >> 6 & 0x3F] : '=';
+        result += '=';
+    }
+    return result;
+}
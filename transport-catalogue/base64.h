@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Кодирует двоичные данные в base64 (RFC 4648, с дополнением '='), чтобы передать их строкой JSON
+std::string EncodeBase64(std::string_view data);
@@ -0,0 +1,390 @@
+#include "deflate.h"
+
+#include <algorithm>
+#include <array>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    const size_t WINDOW_SIZE = 1 << 15;
+    const size_t HASH_BITS = 15;
+    const size_t MIN_MATCH = 3;
+    const size_t MAX_MATCH = 258;
+    // дальше по цепочке хэша не ищем: баланс между скоростью и степенью сжатия
+    const size_t MAX_CHAIN = 64;
+    const size_t NICE_MATCH = 128;
+    const size_t BLOCK_TOKENS = 1 << 16;
+
+    const size_t LITERALS_COUNT = 286;
+    const size_t DISTANCES_COUNT = 30;
+    const size_t CODE_LENGTHS_COUNT = 19;
+    const uint16_t END_OF_BLOCK = 256;
+
+    const std::array<uint16_t, 29> LENGTH_BASE{ 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115,
+        131, 163, 195, 227, 258 };
+    const std::array<uint8_t, 29> LENGTH_EXTRA{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const std::array<uint16_t, 30> DISTANCE_BASE{ 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537,
+        2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const std::array<uint8_t, 30> DISTANCE_EXTRA{ 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    // порядок длин кодов алфавита длин кодов в заголовке блока
+    const std::array<uint8_t, 19> CODE_LENGTHS_ORDER{ 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    // Литерал (distance == 0) или ссылка на повтор
+    struct Token {
+        uint16_t value;
+        uint16_t distance;
+    };
+
+    class BitWriter {
+    public:
+        explicit BitWriter(std::string& out)
+            : out_(out) {
+        }
+
+        // биты пишутся начиная с младшего
+        void Write(uint32_t value, uint32_t count) {
+            bits_ |= static_cast<uint64_t>(value) << count_;
+            count_ += count;
+            while (count_ >= 8) {
+                out_ += static_cast<char>(bits_ & 0xFF);
+                bits_ >>= 8;
+                count_ -= 8;
+            }
+        }
+
+        void Flush() {
+            if (count_ > 0) {
+                out_ += static_cast<char>(bits_ & 0xFF);
+            }
+            bits_ = 0;
+            count_ = 0;
+        }
+
+    private:
+        std::string& out_;
+        uint64_t bits_ = 0;
+        uint32_t count_ = 0;
+    };
+
+    size_t GetLengthCode(size_t length) {
+        return std::upper_bound(LENGTH_BASE.begin(), LENGTH_BASE.end(), length) - LENGTH_BASE.begin() - 1;
+    }
+
+    size_t GetDistanceCode(size_t distance) {
+        return std::upper_bound(DISTANCE_BASE.begin(), DISTANCE_BASE.end(), distance) - DISTANCE_BASE.begin() - 1;
+    }
+
+    // Длины кодов Хаффмана не длиннее max_bits. Если дерево получается глубже,
+    // частоты сглаживаются, пока оно не уложится в ограничение
+    std::vector<uint8_t> BuildCodeLengths(std::vector<uint32_t> freqs, uint8_t max_bits) {
+        // коду нужны хотя бы два символа, иначе его не примут некоторые декодеры
+        for (size_t i = 0, used = std::count_if(freqs.begin(), freqs.end(), [](uint32_t freq) { return freq > 0; }); used < 2; ++i) {
+            if (freqs[i] == 0) {
+                freqs[i] = 1;
+                ++used;
+            }
+        }
+
+        while (true) {
+            using Node = std::pair<uint64_t, size_t>;
+            std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+            std::vector<size_t> parents(freqs.size(), 0);
+            for (size_t i = 0; i < freqs.size(); ++i) {
+                if (freqs[i] > 0) {
+                    queue.emplace(freqs[i], i);
+                }
+            }
+            while (queue.size() > 1) {
+                const auto [first_freq, first] = queue.top();
+                queue.pop();
+                const auto [second_freq, second] = queue.top();
+                queue.pop();
+                parents.push_back(0);
+                parents[first] = parents.size() - 1;
+                parents[second] = parents.size() - 1;
+                queue.emplace(first_freq + second_freq, parents.size() - 1);
+            }
+
+            // корень - последний созданный узел, глубина считается от него вниз по номерам узлов
+            std::vector<uint8_t> depths(parents.size(), 0);
+            for (size_t node = parents.size() - 1; node-- > freqs.size();) {
+                depths[node] = depths[parents[node]] + 1;
+            }
+            std::vector<uint8_t> lengths(freqs.size(), 0);
+            uint8_t max_length = 0;
+            for (size_t i = 0; i < freqs.size(); ++i) {
+                if (freqs[i] > 0) {
+                    lengths[i] = depths[parents[i]] + 1;
+                    max_length = std::max(max_length, lengths[i]);
+                }
+            }
+            if (max_length <= max_bits) {
+                return lengths;
+            }
+            for (uint32_t& freq : freqs) {
+                if (freq > 0) {
+                    freq = (freq + 1) / 2;
+                }
+            }
+        }
+    }
+
+    // Канонические коды по длинам (RFC 1951, 3.2.2), с обращённым порядком бит для BitWriter
+    std::vector<uint16_t> BuildCodes(const std::vector<uint8_t>& lengths) {
+        std::array<uint16_t, 16> length_count{};
+        for (uint8_t length : lengths) {
+            ++length_count[length];
+        }
+        length_count[0] = 0;
+
+        std::array<uint16_t, 16> next_code{};
+        uint16_t code = 0;
+        for (size_t bits = 1; bits < next_code.size(); ++bits) {
+            code = (code + length_count[bits - 1]) << 1;
+            next_code[bits] = code;
+        }
+
+        std::vector<uint16_t> codes(lengths.size(), 0);
+        for (size_t i = 0; i < lengths.size(); ++i) {
+            if (lengths[i] == 0) {
+                continue;
+            }
+            uint16_t value = next_code[lengths[i]]++;
+            uint16_t reversed = 0;
+            for (uint8_t bit = 0; bit < lengths[i]; ++bit) {
+                reversed = (reversed << 1) | (value & 1);
+                value >>= 1;
+            }
+            codes[i] = reversed;
+        }
+        return codes;
+    }
+
+    // Блок с динамическими кодами: заголовок с длинами кодов (RLE символами 16-18), затем токены
+    void WriteBlock(BitWriter& writer, const std::vector<Token>& tokens, bool is_final) {
+        std::vector<uint32_t> literal_freqs(LITERALS_COUNT, 0);
+        std::vector<uint32_t> distance_freqs(DISTANCES_COUNT, 0);
+        for (const Token& token : tokens) {
+            if (token.distance == 0) {
+                ++literal_freqs[token.value];
+            }
+            else {
+                ++literal_freqs[257 + GetLengthCode(token.value)];
+                ++distance_freqs[GetDistanceCode(token.distance)];
+            }
+        }
+        ++literal_freqs[END_OF_BLOCK];
+
+        const std::vector<uint8_t> literal_lengths = BuildCodeLengths(literal_freqs, 15);
+        const std::vector<uint8_t> distance_lengths = BuildCodeLengths(distance_freqs, 15);
+        const std::vector<uint16_t> literal_codes = BuildCodes(literal_lengths);
+        const std::vector<uint16_t> distance_codes = BuildCodes(distance_lengths);
+
+        size_t literals_used = LITERALS_COUNT;
+        while (literals_used > 257 && literal_lengths[literals_used - 1] == 0) {
+            --literals_used;
+        }
+        size_t distances_used = DISTANCES_COUNT;
+        while (distances_used > 1 && distance_lengths[distances_used - 1] == 0) {
+            --distances_used;
+        }
+
+        std::vector<uint8_t> all_lengths(literal_lengths.begin(), literal_lengths.begin() + literals_used);
+        all_lengths.insert(all_lengths.end(), distance_lengths.begin(), distance_lengths.begin() + distances_used);
+
+        // пары (символ, дополнительные биты) для длин кодов
+        std::vector<std::pair<uint8_t, uint8_t>> length_symbols;
+        for (size_t i = 0; i < all_lengths.size();) {
+            size_t run = 1;
+            while (i + run < all_lengths.size() && all_lengths[i + run] == all_lengths[i]) {
+                ++run;
+            }
+            if (all_lengths[i] == 0 && run >= 11) {
+                run = std::min<size_t>(run, 138);
+                length_symbols.emplace_back(18, static_cast<uint8_t>(run - 11));
+            }
+            else if (all_lengths[i] == 0 && run >= 3) {
+                length_symbols.emplace_back(17, static_cast<uint8_t>(run - 3));
+            }
+            else if (all_lengths[i] != 0 && run >= 4) {
+                run = std::min<size_t>(run, 7);
+                length_symbols.emplace_back(all_lengths[i], 0);
+                length_symbols.emplace_back(16, static_cast<uint8_t>(run - 4));
+            }
+            else {
+                run = 1;
+                length_symbols.emplace_back(all_lengths[i], 0);
+            }
+            i += run;
+        }
+
+        std::vector<uint32_t> code_length_freqs(CODE_LENGTHS_COUNT, 0);
+        for (const auto& [symbol, extra] : length_symbols) {
+            ++code_length_freqs[symbol];
+        }
+        const std::vector<uint8_t> code_length_lengths = BuildCodeLengths(code_length_freqs, 7);
+        const std::vector<uint16_t> code_length_codes = BuildCodes(code_length_lengths);
+        size_t code_lengths_used = CODE_LENGTHS_COUNT;
+        while (code_lengths_used > 4 && code_length_lengths[CODE_LENGTHS_ORDER[code_lengths_used - 1]] == 0) {
+            --code_lengths_used;
+        }
+
+        writer.Write(is_final ? 1 : 0, 1);
+        writer.Write(2, 2);
+        writer.Write(static_cast<uint32_t>(literals_used - 257), 5);
+        writer.Write(static_cast<uint32_t>(distances_used - 1), 5);
+        writer.Write(static_cast<uint32_t>(code_lengths_used - 4), 4);
+        for (size_t i = 0; i < code_lengths_used; ++i) {
+            writer.Write(code_length_lengths[CODE_LENGTHS_ORDER[i]], 3);
+        }
+        for (const auto& [symbol, extra] : length_symbols) {
+            writer.Write(code_length_codes[symbol], code_length_lengths[symbol]);
+            if (symbol == 16) {
+                writer.Write(extra, 2);
+            }
+            else if (symbol == 17) {
+                writer.Write(extra, 3);
+            }
+            else if (symbol == 18) {
+                writer.Write(extra, 7);
+            }
+        }
+
+        for (const Token& token : tokens) {
+            if (token.distance == 0) {
+                writer.Write(literal_codes[token.value], literal_lengths[token.value]);
+                continue;
+            }
+            const size_t length_code = GetLengthCode(token.value);
+            writer.Write(literal_codes[257 + length_code], literal_lengths[257 + length_code]);
+            writer.Write(token.value - LENGTH_BASE[length_code], LENGTH_EXTRA[length_code]);
+
+            const size_t distance_code = GetDistanceCode(token.distance);
+            writer.Write(distance_codes[distance_code], distance_lengths[distance_code]);
+            writer.Write(token.distance - DISTANCE_BASE[distance_code], DISTANCE_EXTRA[distance_code]);
+        }
+        writer.Write(literal_codes[END_OF_BLOCK], literal_lengths[END_OF_BLOCK]);
+    }
+
+    uint32_t GetHash(const unsigned char* bytes) {
+        const uint32_t value = bytes[0] | bytes[1] << 8 | bytes[2] << 16;
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    void AppendLittleEndian(std::string& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out += static_cast<char>(value >> (8 * i) & 0xFF);
+        }
+    }
+
+}
+
+std::string CompressDeflate(std::string_view data) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    const size_t size = data.size();
+
+    // head - последняя позиция с данным хэшем, prev - предыдущая позиция с тем же хэшем в пределах окна
+    std::vector<int64_t> head(size_t{ 1 } << HASH_BITS, -1);
+    std::vector<int64_t> prev(WINDOW_SIZE, -1);
+    const auto insert = [&](size_t pos) {
+        if (pos + MIN_MATCH <= size) {
+            const uint32_t hash = GetHash(bytes + pos);
+            prev[pos & (WINDOW_SIZE - 1)] = head[hash];
+            head[hash] = static_cast<int64_t>(pos);
+        }
+    };
+
+    std::string result;
+    BitWriter writer(result);
+    std::vector<Token> tokens;
+    tokens.reserve(BLOCK_TOKENS);
+
+    size_t pos = 0;
+    while (pos < size) {
+        size_t best_length = 0;
+        size_t best_distance = 0;
+        if (pos + MIN_MATCH <= size) {
+            const size_t max_length = std::min(MAX_MATCH, size - pos);
+            int64_t candidate = head[GetHash(bytes + pos)];
+            for (size_t chain = 0; candidate >= 0 && chain < MAX_CHAIN; ++chain) {
+                const size_t distance = pos - static_cast<size_t>(candidate);
+                if (distance >= WINDOW_SIZE) {
+                    break;
+                }
+                const unsigned char* match = bytes + candidate;
+                if (match[best_length] == bytes[pos + best_length] || best_length == 0) {
+                    size_t length = 0;
+                    while (length < max_length && match[length] == bytes[pos + length]) {
+                        ++length;
+                    }
+                    if (length > best_length) {
+                        best_length = length;
+                        best_distance = distance;
+                        if (length >= NICE_MATCH || length == max_length) {
+                            break;
+                        }
+                    }
+                }
+                const int64_t next = prev[static_cast<size_t>(candidate) & (WINDOW_SIZE - 1)];
+                if (next >= candidate) {
+                    break;
+                }
+                candidate = next;
+            }
+        }
+
+        if (best_length >= MIN_MATCH) {
+            tokens.push_back({ static_cast<uint16_t>(best_length), static_cast<uint16_t>(best_distance) });
+            for (size_t i = 0; i < best_length; ++i) {
+                insert(pos + i);
+            }
+            pos += best_length;
+        }
+        else {
+            tokens.push_back({ bytes[pos], 0 });
+            insert(pos);
+            ++pos;
+        }
+
+        if (tokens.size() == BLOCK_TOKENS) {
+            WriteBlock(writer, tokens, pos == size);
+            tokens.clear();
+        }
+    }
+    if (!tokens.empty() || size == 0) {
+        WriteBlock(writer, tokens, true);
+    }
+    writer.Flush();
+    return result;
+}
+
+std::string CompressGzip(std::string_view data) {
+    // заголовок: сигнатура, метод deflate, без флагов и времени, ОС не указана
+    std::string result{ '\x1f', '\x8b', '\x08', '\0', '\0', '\0', '\0', '\0', '\0', '\xff' };
+    result += CompressDeflate(data);
+    AppendLittleEndian(result, ComputeCrc32(data));
+    AppendLittleEndian(result, static_cast<uint32_t>(data.size()));
+    return result;
+}
+
+uint32_t ComputeCrc32(std::string_view data) {
+    static const std::array<uint32_t, 256> table = []() {
+        std::array<uint32_t, 256> result{};
+        for (uint32_t i = 0; i < result.size(); ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            result[i] = value;
+        }
+        return result;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (char c : data) {
+        crc = table[(crc ^ static_cast<unsigned char>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
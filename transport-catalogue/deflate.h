@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Сжатие deflate (RFC 1951): LZ77 со скользящим окном 32 КБ и динамическими кодами Хаффмана в каждом блоке
+std::string CompressDeflate(std::string_view data);
+
+// Поток gzip (RFC 1952) из одного элемента, читается gunzip и любыми HTTP-клиентами
+std::string CompressGzip(std::string_view data);
+
+uint32_t ComputeCrc32(std::string_view data);
@@ -1,20 +1,145 @@
 #pragma once
 
 #include "geo.h"
+#include "ranges.h"
 
+#include <cstddef>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
+// Названия и последовательности остановок хранятся в аренах справочника, Stop и Bus ссылаются на них
 struct Stop {
-	std::string stop_name;
+	std::string_view stop_name;
 	catalogue::detail::Coordinates coordinates;
+	// порядковый номер остановки в справочнике
+	size_t id = 0;
+};
+
+// Остановки маршрута в порядке проезда поверх основной последовательности, без копирования:
+// у некольцевого маршрута после конечной идут остановки в обратном порядке, конечная не повторяется
+class RouteStops {
+public:
+	class Iterator {
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = const Stop*;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Stop* const*;
+		using reference = const Stop*;
+
+		Iterator() = default;
+		Iterator(const Stop* const* stops, size_t count, size_t index)
+			: stops_(stops), count_(count), index_(index) {
+		}
+
+		reference operator*() const {
+			return index_ < count_ ? stops_[index_] : stops_[2 * count_ - 2 - index_];
+		}
+		reference operator[](difference_type offset) const {
+			return *(*this + offset);
+		}
+
+		Iterator& operator++() {
+			++index_;
+			return *this;
+		}
+		Iterator operator++(int) {
+			Iterator result = *this;
+			++index_;
+			return result;
+		}
+		Iterator& operator--() {
+			--index_;
+			return *this;
+		}
+		Iterator operator--(int) {
+			Iterator result = *this;
+			--index_;
+			return result;
+		}
+		Iterator& operator+=(difference_type offset) {
+			index_ += offset;
+			return *this;
+		}
+		Iterator& operator-=(difference_type offset) {
+			index_ -= offset;
+			return *this;
+		}
+		Iterator operator+(difference_type offset) const {
+			return Iterator(*this) += offset;
+		}
+		Iterator operator-(difference_type offset) const {
+			return Iterator(*this) -= offset;
+		}
+		difference_type operator-(const Iterator& other) const {
+			return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+		}
+
+		bool operator==(const Iterator& other) const {
+			return index_ == other.index_;
+		}
+		bool operator!=(const Iterator& other) const {
+			return index_ != other.index_;
+		}
+		bool operator<(const Iterator& other) const {
+			return index_ < other.index_;
+		}
+
+	private:
+		const Stop* const* stops_ = nullptr;
+		size_t count_ = 0;
+		size_t index_ = 0;
+	};
+
+	RouteStops(ranges::Range<const Stop* const*> stops, bool is_roundtrip)
+		: stops_(stops), is_roundtrip_(is_roundtrip) {
+	}
+
+	size_t size() const {
+		return is_roundtrip_ || stops_.empty() ? stops_.size() : 2 * stops_.size() - 1;
+	}
+	bool empty() const {
+		return stops_.empty();
+	}
+	const Stop* operator[](size_t index) const {
+		return begin()[index];
+	}
+
+	Iterator begin() const {
+		return { stops_.begin(), stops_.size(), 0 };
+	}
+	Iterator end() const {
+		return { stops_.begin(), stops_.size(), size() };
+	}
+
+private:
+	ranges::Range<const Stop* const*> stops_;
+	bool is_roundtrip_;
 };
 
 struct Bus {
-	std::string bus_name;
-	std::vector<const Stop*> stops;
+	std::string_view bus_name;
+	// остановки в том виде, в каком заданы во входных данных: у некольцевого маршрута - от начальной до конечной
+	ranges::Range<const Stop* const*> stops;
 	bool is_roundtrip;
+	// собственные интервал движения (мин) и скорость (км/ч) маршрута, 0 - значения из настроек маршрутизации
+	double headway = 0.;
+	double velocity = 0.;
+	// время отправления рейсов с начальной остановки в минутах от начала суток, по возрастанию
+	std::vector<double> departures;
+
+	// Все остановки рейса; у некольцевого маршрута - туда и обратно
+	RouteStops GetRouteStops() const {
+		return { stops, is_roundtrip };
+	}
+
+	// Вторая конечная некольцевого маршрута или начальная остановка кольцевого
+	const Stop* GetLastTerminal() const {
+		return stops[stops.size() - 1];
+	}
 };
 
 using StopMap = std::unordered_map<std::string_view, const Stop*>;
@@ -32,6 +157,11 @@ struct BusStat {
 struct RouteSettings {
 	double bus_wait_time = 0.;
 	double bus_velocity = 0.;
+	// скорость пешехода (км/ч) и число ближайших остановок для маршрутов между координатами
+	double walking_velocity = 5.;
+	size_t walking_stops_count = 3;
+	// число маршрутов между остановками в кэше маршрутизатора, 0 - без кэша
+	size_t route_cache_size = 1 << 14;
 };
 
 struct StopId {
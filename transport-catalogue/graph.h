@@ -1,5 +1,6 @@
 #pragma once
 
+#include "memory_usage.h"
 #include "ranges.h"
 
 #include <cstdlib>
@@ -27,12 +28,16 @@ namespace graph {
         DirectedWeightedGraph() = default;
         explicit DirectedWeightedGraph(size_t vertex_count);
         EdgeId AddEdge(const Edge<Weight>& edge);
+        // Резервирует память под заранее известное число рёбер
+        void ReserveEdges(size_t edge_count);
 
         size_t GetVertexCount() const;
         size_t GetEdgeCount() const;
         const Edge<Weight>& GetEdge(EdgeId edge_id) const;
         IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
+        instrumentation::MemoryBreakdown MemoryUsage() const;
+
     private:
         std::vector<Edge<Weight>> edges_;
         std::vector<IncidenceList> incidence_lists_;
@@ -51,6 +56,11 @@ namespace graph {
         return id;
     }
 
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::ReserveEdges(size_t edge_count) {
+        edges_.reserve(edge_count);
+    }
+
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
         return incidence_lists_.size();
@@ -71,4 +81,12 @@ namespace graph {
         DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
         return ranges::AsRange(incidence_lists_.at(vertex));
     }
+
+    template <typename Weight>
+    instrumentation::MemoryBreakdown DirectedWeightedGraph<Weight>::MemoryUsage() const {
+        instrumentation::MemoryBreakdown usage;
+        usage.Add("edges", instrumentation::GetHeapMemory(edges_));
+        usage.Add("incidence_lists", instrumentation::GetHeapMemory(incidence_lists_));
+        return usage;
+    }
 }  // namespace graph
\ No newline at end of file
@@ -0,0 +1,328 @@
+#include "instrumentation.h"
+
+#include "json.h"
+
+#include <algorithm>
+#include <deque>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace instrumentation {
+
+    namespace {
+
+        // deque не перемещает элементы при добавлении, поэтому ссылки из статических переменных остаются верными
+        struct Registry {
+            std::mutex mutex;
+            std::deque<std::pair<std::string, TimerStat>> timers;
+            std::deque<std::pair<std::string, CounterStat>> counters;
+            std::deque<std::pair<std::string, LatencyHistogram>> histograms;
+
+            static Registry& Instance() {
+                static Registry registry;
+                return registry;
+            }
+        };
+
+        template <typename Stat>
+        Stat& Register(std::deque<std::pair<std::string, Stat>>& stats, std::string_view name) {
+            for (auto& [stat_name, stat] : stats) {
+                if (stat_name == name) {
+                    return stat;
+                }
+            }
+            return stats.emplace_back(std::piecewise_construct, std::forward_as_tuple(name), std::forward_as_tuple()).second;
+        }
+
+        double ToMilliseconds(uint64_t nanoseconds) {
+            return static_cast<double>(nanoseconds) / 1e6;
+        }
+
+        double ToMicroseconds(uint64_t nanoseconds) {
+            return static_cast<double>(nanoseconds) / 1e3;
+        }
+
+        void UpdateMax(std::atomic<uint64_t>& max_value, uint64_t value) {
+            uint64_t current_max = max_value.load(std::memory_order_relaxed);
+            while (current_max < value && !max_value.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+            }
+        }
+
+        // Номер старшего единичного бита, value > 0
+        size_t GetHighestBit(uint64_t value) {
+            size_t bit = 0;
+            for (size_t step = 32; step > 0; step /= 2) {
+                if (value >> step) {
+                    value >>= step;
+                    bit += step;
+                }
+            }
+            return bit;
+        }
+
+    }
+
+    void TimerStat::Record(uint64_t nanoseconds) {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        total_ns.fetch_add(nanoseconds, std::memory_order_relaxed);
+        UpdateMax(max_ns, nanoseconds);
+    }
+
+    void LatencyHistogram::Record(uint64_t nanoseconds) {
+        counts_[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        total_ns_.fetch_add(nanoseconds, std::memory_order_relaxed);
+        UpdateMax(max_ns_, nanoseconds);
+    }
+
+    uint64_t LatencyHistogram::GetCount() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t LatencyHistogram::GetTotal() const {
+        return total_ns_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t LatencyHistogram::GetMax() const {
+        return max_ns_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t LatencyHistogram::GetPercentile(double percentile) const {
+        const uint64_t count = GetCount();
+        if (count == 0) {
+            return 0;
+        }
+        // ранг нужного значения среди отсортированных, от 1 до count
+        const uint64_t rank = std::clamp<uint64_t>(static_cast<uint64_t>(percentile / 100. * static_cast<double>(count) + 0.999999), 1, count);
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < BUCKETS_COUNT; ++bucket) {
+            seen += counts_[bucket].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return std::min(GetBucketUpperBound(bucket), GetMax());
+            }
+        }
+        return GetMax();
+    }
+
+    void LatencyHistogram::Reset() {
+        for (std::atomic<uint64_t>& count : counts_) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        total_ns_.store(0, std::memory_order_relaxed);
+        max_ns_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t LatencyHistogram::GetBucket(uint64_t value) {
+        if (value < SUB_BUCKETS_COUNT) {
+            return static_cast<size_t>(value);
+        }
+        const size_t shift = GetHighestBit(value) - SUB_BUCKET_BITS;
+        // старший бит отбрасывается, следующие SUB_BUCKET_BITS бит - номер части интервала
+        return SUB_BUCKETS_COUNT * (shift + 1) + static_cast<size_t>((value >> shift) - SUB_BUCKETS_COUNT);
+    }
+
+    uint64_t LatencyHistogram::GetBucketUpperBound(size_t bucket) {
+        if (bucket < SUB_BUCKETS_COUNT) {
+            return bucket;
+        }
+        const size_t shift = bucket / SUB_BUCKETS_COUNT - 1;
+        const uint64_t lower = (SUB_BUCKETS_COUNT + bucket % SUB_BUCKETS_COUNT) << shift;
+        return lower + ((uint64_t{ 1 } << shift) - 1);
+    }
+
+    SlowQueryLog::~SlowQueryLog() {
+        Reset();
+    }
+
+    void SlowQueryLog::SetThreshold(uint64_t nanoseconds) {
+        threshold_ns_.store(nanoseconds, std::memory_order_relaxed);
+    }
+
+    void SlowQueryLog::Record(SlowQuery query) {
+        query.sequence = next_sequence_.fetch_add(1, std::memory_order_relaxed);
+        SlowQuery* entry = new SlowQuery(std::move(query));
+        delete slots_[entry->sequence % CAPACITY].exchange(entry, std::memory_order_acq_rel);
+    }
+
+    std::vector<SlowQuery> SlowQueryLog::GetQueries() const {
+        std::vector<SlowQuery> result;
+        for (std::atomic<SlowQuery*>& slot : slots_) {
+            // запись забирается из слота на время копирования и возвращается, если слот за это время не заняли
+            SlowQuery* entry = slot.exchange(nullptr, std::memory_order_acq_rel);
+            if (entry == nullptr) {
+                continue;
+            }
+            result.push_back(*entry);
+            SlowQuery* expected = nullptr;
+            if (!slot.compare_exchange_strong(expected, entry, std::memory_order_acq_rel)) {
+                delete entry;
+            }
+        }
+        std::sort(result.begin(), result.end(), [](const SlowQuery& lhs, const SlowQuery& rhs) {
+            return lhs.sequence < rhs.sequence;
+        });
+        return result;
+    }
+
+    uint64_t SlowQueryLog::GetTotalCount() const {
+        return next_sequence_.load(std::memory_order_relaxed);
+    }
+
+    void SlowQueryLog::Reset() {
+        for (std::atomic<SlowQuery*>& slot : slots_) {
+            delete slot.exchange(nullptr, std::memory_order_acq_rel);
+        }
+        next_sequence_.store(0, std::memory_order_relaxed);
+    }
+
+    SlowQueryLog& GetSlowQueryLog() {
+        static SlowQueryLog log;
+        return log;
+    }
+
+    TimerStat& RegisterTimer(std::string_view name) {
+        Registry& registry = Registry::Instance();
+        std::lock_guard lock(registry.mutex);
+        return Register(registry.timers, name);
+    }
+
+    CounterStat& RegisterCounter(std::string_view name) {
+        Registry& registry = Registry::Instance();
+        std::lock_guard lock(registry.mutex);
+        return Register(registry.counters, name);
+    }
+
+    LatencyHistogram& RegisterHistogram(std::string_view name) {
+        Registry& registry = Registry::Instance();
+        std::lock_guard lock(registry.mutex);
+        return Register(registry.histograms, name);
+    }
+
+    void PrintReport(std::ostream& out) {
+        Registry& registry = Registry::Instance();
+        std::lock_guard lock(registry.mutex);
+
+        out << std::left << std::setw(40) << "timer" << std::right << std::setw(10) << "calls" << std::setw(14) << "total ms"
+            << std::setw(14) << "avg ms" << std::setw(14) << "max ms" << '\n';
+        for (const auto& [name, stat] : registry.timers) {
+            const uint64_t calls = stat.calls.load(std::memory_order_relaxed);
+            const uint64_t total = stat.total_ns.load(std::memory_order_relaxed);
+            out << std::left << std::setw(40) << name << std::right << std::setw(10) << calls << std::fixed << std::setprecision(3)
+                << std::setw(14) << ToMilliseconds(total) << std::setw(14) << (calls ? ToMilliseconds(total) / calls : 0.)
+                << std::setw(14) << ToMilliseconds(stat.max_ns.load(std::memory_order_relaxed)) << '\n';
+            out << std::defaultfloat;
+        }
+        for (const auto& [name, stat] : registry.counters) {
+            out << std::left << std::setw(40) << name << std::right << std::setw(10) << stat.value.load(std::memory_order_relaxed) << '\n';
+        }
+
+        if (!registry.histograms.empty()) {
+            out << std::left << std::setw(40) << "latency, us" << std::right << std::setw(10) << "count" << std::setw(14) << "p50"
+                << std::setw(14) << "p99" << std::setw(14) << "p99.9" << std::setw(14) << "max" << '\n';
+        }
+        for (const auto& [name, histogram] : registry.histograms) {
+            out << std::left << std::setw(40) << name << std::right << std::setw(10) << histogram.GetCount() << std::fixed << std::setprecision(1)
+                << std::setw(14) << ToMicroseconds(histogram.GetPercentile(50.)) << std::setw(14) << ToMicroseconds(histogram.GetPercentile(99.))
+                << std::setw(14) << ToMicroseconds(histogram.GetPercentile(99.9)) << std::setw(14) << ToMicroseconds(histogram.GetMax()) << '\n';
+            out << std::defaultfloat;
+        }
+
+        const SlowQueryLog& log = GetSlowQueryLog();
+        const std::vector<SlowQuery> slow_queries = log.GetQueries();
+        if (log.GetTotalCount() > 0) {
+            out << "slow queries: " << log.GetTotalCount() << ", last " << slow_queries.size() << '\n';
+        }
+        for (const SlowQuery& query : slow_queries) {
+            out << "  " << query.type << " id " << query.request_id << ": " << std::fixed << std::setprecision(3)
+                << ToMilliseconds(query.total_ns) << std::defaultfloat << " ms";
+            if (query.work.searches > 0) {
+                out << ", searches " << query.work.searches << ", vertices settled " << query.work.vertices_settled
+                    << ", edges relaxed " << query.work.edges_relaxed;
+            }
+            if (!query.parameters.empty()) {
+                out << ", " << query.parameters;
+            }
+            out << '\n';
+        }
+    }
+
+    void PrintJsonReport(std::ostream& out) {
+        using namespace std::literals;
+
+        Registry& registry = Registry::Instance();
+        std::lock_guard lock(registry.mutex);
+
+        json::Array timers;
+        for (const auto& [name, stat] : registry.timers) {
+            json::Dict timer{
+                { "name"s, json::Node{ name } },
+                { "calls"s, json::Node{ static_cast<double>(stat.calls.load(std::memory_order_relaxed)) } },
+                { "total_ms"s, json::Node{ ToMilliseconds(stat.total_ns.load(std::memory_order_relaxed)) } },
+                { "max_ms"s, json::Node{ ToMilliseconds(stat.max_ns.load(std::memory_order_relaxed)) } },
+            };
+            timers.emplace_back(std::move(timer));
+        }
+        json::Dict counters;
+        for (const auto& [name, stat] : registry.counters) {
+            counters.emplace(name, json::Node{ static_cast<double>(stat.value.load(std::memory_order_relaxed)) });
+        }
+
+        json::Array histograms;
+        for (const auto& [name, histogram] : registry.histograms) {
+            json::Dict entry{
+                { "name"s, json::Node{ name } },
+                { "count"s, json::Node{ static_cast<double>(histogram.GetCount()) } },
+                { "total_ms"s, json::Node{ ToMilliseconds(histogram.GetTotal()) } },
+                { "p50_us"s, json::Node{ ToMicroseconds(histogram.GetPercentile(50.)) } },
+                { "p99_us"s, json::Node{ ToMicroseconds(histogram.GetPercentile(99.)) } },
+                { "p999_us"s, json::Node{ ToMicroseconds(histogram.GetPercentile(99.9)) } },
+                { "max_us"s, json::Node{ ToMicroseconds(histogram.GetMax()) } },
+            };
+            histograms.emplace_back(std::move(entry));
+        }
+        json::Array slow_queries;
+        for (const SlowQuery& query : GetSlowQueryLog().GetQueries()) {
+            json::Dict entry{
+                { "type"s, json::Node{ query.type } },
+                { "request_id"s, json::Node{ query.request_id } },
+                { "parameters"s, json::Node{ query.parameters } },
+                { "total_ms"s, json::Node{ ToMilliseconds(query.total_ns) } },
+                { "searches"s, json::Node{ static_cast<double>(query.work.searches) } },
+                { "vertices_settled"s, json::Node{ static_cast<double>(query.work.vertices_settled) } },
+                { "edges_relaxed"s, json::Node{ static_cast<double>(query.work.edges_relaxed) } },
+            };
+            slow_queries.emplace_back(std::move(entry));
+        }
+
+        // записи собираются в Dict и перемещаются: вложенные временные Builder дают ложные -Wmaybe-uninitialized при -O2
+        json::Dict report{
+            { "timers"s, json::Node{ std::move(timers) } },
+            { "counters"s, json::Node{ std::move(counters) } },
+            { "histograms"s, json::Node{ std::move(histograms) } },
+            { "slow_queries_count"s, json::Node{ static_cast<double>(GetSlowQueryLog().GetTotalCount()) } },
+            { "slow_queries"s, json::Node{ std::move(slow_queries) } },
+        };
+        json::Print(json::Document{ json::Node{ std::move(report) } }, out);
+    }
+
+    void Reset() {
+        Registry& registry = Registry::Instance();
+        std::lock_guard lock(registry.mutex);
+        for (auto& [name, stat] : registry.timers) {
+            stat.calls.store(0, std::memory_order_relaxed);
+            stat.total_ns.store(0, std::memory_order_relaxed);
+            stat.max_ns.store(0, std::memory_order_relaxed);
+        }
+        for (auto& [name, stat] : registry.counters) {
+            stat.value.store(0, std::memory_order_relaxed);
+        }
+        for (auto& [name, histogram] : registry.histograms) {
+            histogram.Reset();
+        }
+        GetSlowQueryLog().Reset();
+    }
+
+}  // namespace instrumentation
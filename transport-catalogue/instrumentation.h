@@ -0,0 +1,251 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Встроенные замеры этапов: таймеры и счётчики.
+// Место замера регистрируется один раз при первом выполнении (статическая переменная),
+// дальше запись - пара атомарных операций без блокировок.
+// Сборка с TC_DISABLE_INSTRUMENTATION убирает замеры из кода полностью
+namespace instrumentation {
+
+    // Накопленное время одного таймера
+    struct TimerStat {
+        std::atomic<uint64_t> calls{ 0 };
+        std::atomic<uint64_t> total_ns{ 0 };
+        std::atomic<uint64_t> max_ns{ 0 };
+
+        void Record(uint64_t nanoseconds);
+    };
+
+    struct CounterStat {
+        std::atomic<int64_t> value{ 0 };
+
+        void Add(int64_t delta) {
+            value.fetch_add(delta, std::memory_order_relaxed);
+        }
+    };
+
+    // Гистограмма задержек в духе HDR: значения до 2^SUB_BUCKET_BITS нс хранятся точно, дальше каждый
+    // интервал [2^k, 2^(k+1)) делится на 2^SUB_BUCKET_BITS равных частей, то есть погрешность не больше 1/32
+    class LatencyHistogram {
+    public:
+        static constexpr size_t SUB_BUCKET_BITS = 5;
+        static constexpr size_t SUB_BUCKETS_COUNT = size_t{ 1 } << SUB_BUCKET_BITS;
+        static constexpr size_t BUCKETS_COUNT = SUB_BUCKETS_COUNT * (64 - SUB_BUCKET_BITS + 1);
+
+        void Record(uint64_t nanoseconds);
+
+        uint64_t GetCount() const;
+        uint64_t GetTotal() const;
+        uint64_t GetMax() const;
+        // Верхняя граница интервала, в который попадает перцентиль percentile (от 0 до 100)
+        uint64_t GetPercentile(double percentile) const;
+
+        void Reset();
+
+    private:
+        static size_t GetBucket(uint64_t value);
+        static uint64_t GetBucketUpperBound(size_t bucket);
+
+        std::array<std::atomic<uint64_t>, BUCKETS_COUNT> counts_{};
+        std::atomic<uint64_t> count_{ 0 };
+        std::atomic<uint64_t> total_ns_{ 0 };
+        std::atomic<uint64_t> max_ns_{ 0 };
+    };
+
+    // Работа поисков по графу, выполненных текущим потоком: накапливается поисками,
+    // запрос берёт разницу между началом и концом
+    struct SearchWork {
+        uint64_t searches = 0;
+        uint64_t vertices_settled = 0;
+        uint64_t edges_relaxed = 0;
+    };
+
+    inline SearchWork& CurrentSearchWork() {
+        static thread_local SearchWork work;
+        return work;
+    }
+
+    // Запись журнала медленных запросов
+    struct SlowQuery {
+        uint64_t sequence = 0;
+        std::string type;
+        int request_id = 0;
+        std::string parameters;
+        uint64_t total_ns = 0;
+        SearchWork work;
+    };
+
+    // Последние CAPACITY запросов дольше порога. Запись без блокировок: новая запись подменяет
+    // старую в кольце слотов атомарным обменом указателя, владелец у каждой записи всегда один
+    class SlowQueryLog {
+    public:
+        static constexpr size_t CAPACITY = 128;
+
+        SlowQueryLog() = default;
+        SlowQueryLog(const SlowQueryLog&) = delete;
+        SlowQueryLog& operator=(const SlowQueryLog&) = delete;
+        ~SlowQueryLog();
+
+        // Порог в наносекундах, 0 выключает журнал
+        void SetThreshold(uint64_t nanoseconds);
+        bool IsSlow(uint64_t nanoseconds) const {
+            const uint64_t threshold = threshold_ns_.load(std::memory_order_relaxed);
+            return threshold != 0 && nanoseconds >= threshold;
+        }
+
+        void Record(SlowQuery query);
+
+        // Записи в порядке поступления и сколько медленных запросов было всего
+        std::vector<SlowQuery> GetQueries() const;
+        uint64_t GetTotalCount() const;
+
+        void Reset();
+
+    private:
+        std::atomic<uint64_t> threshold_ns_{ 0 };
+        std::atomic<uint64_t> next_sequence_{ 0 };
+        mutable std::array<std::atomic<SlowQuery*>, CAPACITY> slots_{};
+    };
+
+    SlowQueryLog& GetSlowQueryLog();
+
+    // Повторная регистрация с тем же именем возвращает ту же запись. Адреса записей не меняются
+    TimerStat& RegisterTimer(std::string_view name);
+    CounterStat& RegisterCounter(std::string_view name);
+    LatencyHistogram& RegisterHistogram(std::string_view name);
+
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(TimerStat& stat)
+            : stat_(stat)
+            , start_(std::chrono::steady_clock::now()) {
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+        ~ScopedTimer() {
+            stat_.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_).count()));
+        }
+
+    private:
+        TimerStat& stat_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    // Начало замера для запросов, которые обрабатываются вместе (маршруты из одной остановки):
+    // замер каждого из них отсчитывается от конца предыдущего
+    struct LatencyMark {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        SearchWork work = CurrentSearchWork();
+    };
+
+    // Замер одного запроса: задержка попадает в гистограмму, а если превышен порог журнала,
+    // describe(SlowQuery&) дописывает в запись журнала номер и параметры запроса
+    template <typename Describe>
+    class ScopedLatency {
+    public:
+        ScopedLatency(std::string_view name, LatencyHistogram& histogram, const Describe& describe)
+            : name_(name)
+            , histogram_(histogram)
+            , describe_(describe)
+            , work_(CurrentSearchWork())
+            , start_(std::chrono::steady_clock::now()) {
+        }
+
+        // Замер от mark; по окончании mark сдвигается на его конец
+        ScopedLatency(std::string_view name, LatencyHistogram& histogram, const Describe& describe, LatencyMark& mark)
+            : name_(name)
+            , histogram_(histogram)
+            , describe_(describe)
+            , work_(mark.work)
+            , start_(mark.start)
+            , mark_(&mark) {
+        }
+
+        ScopedLatency(const ScopedLatency&) = delete;
+        ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+        ~ScopedLatency() {
+            const uint64_t nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_).count());
+            histogram_.Record(nanoseconds);
+
+            SlowQueryLog& log = GetSlowQueryLog();
+            if (log.IsSlow(nanoseconds)) {
+                const SearchWork& work = CurrentSearchWork();
+                SlowQuery query;
+                query.type = std::string(name_);
+                query.total_ns = nanoseconds;
+                query.work = { work.searches - work_.searches, work.vertices_settled - work_.vertices_settled,
+                    work.edges_relaxed - work_.edges_relaxed };
+                describe_(query);
+                log.Record(std::move(query));
+            }
+
+            if (mark_ != nullptr) {
+                *mark_ = LatencyMark{};
+            }
+        }
+
+    private:
+        std::string_view name_;
+        LatencyHistogram& histogram_;
+        const Describe& describe_;
+        SearchWork work_;
+        std::chrono::steady_clock::time_point start_;
+        LatencyMark* mark_ = nullptr;
+    };
+
+    // Отчёт в порядке регистрации: таблица для человека и JSON для сравнения прогонов
+    void PrintReport(std::ostream& out);
+    void PrintJsonReport(std::ostream& out);
+
+    // Обнуляет накопленные значения, зарегистрированные места остаются
+    void Reset();
+
+}  // namespace instrumentation
+
+#define TC_INSTRUMENTATION_CONCAT_IMPL(lhs, rhs) lhs##rhs
+#define TC_INSTRUMENTATION_CONCAT(lhs, rhs) TC_INSTRUMENTATION_CONCAT_IMPL(lhs, rhs)
+
+#ifndef TC_DISABLE_INSTRUMENTATION
+
+// Замеряет время до конца текущего блока
+#define TC_SCOPED_TIMER(name) \
+    static ::instrumentation::TimerStat& TC_INSTRUMENTATION_CONCAT(tc_timer_stat_, __LINE__) = ::instrumentation::RegisterTimer(name); \
+    const ::instrumentation::ScopedTimer TC_INSTRUMENTATION_CONCAT(tc_timer_, __LINE__)(TC_INSTRUMENTATION_CONCAT(tc_timer_stat_, __LINE__))
+
+#define TC_COUNTER_ADD(name, delta) \
+    do { \
+        static ::instrumentation::CounterStat& tc_counter_stat = ::instrumentation::RegisterCounter(name); \
+        tc_counter_stat.Add(static_cast<int64_t>(delta)); \
+    } while (false)
+
+// Задержка до конца текущего блока в гистограмму name и, если она выше порога, в журнал медленных запросов
+#define TC_SCOPED_LATENCY(name, describe) \
+    static ::instrumentation::LatencyHistogram& TC_INSTRUMENTATION_CONCAT(tc_histogram_, __LINE__) = ::instrumentation::RegisterHistogram(name); \
+    const ::instrumentation::ScopedLatency TC_INSTRUMENTATION_CONCAT(tc_latency_, __LINE__)(name, TC_INSTRUMENTATION_CONCAT(tc_histogram_, __LINE__), describe)
+
+// То же, но задержка отсчитывается от mark (LatencyMark), который затем сдвигается на конец блока
+#define TC_SCOPED_LATENCY_FROM(name, describe, mark) \
+    static ::instrumentation::LatencyHistogram& TC_INSTRUMENTATION_CONCAT(tc_histogram_, __LINE__) = ::instrumentation::RegisterHistogram(name); \
+    const ::instrumentation::ScopedLatency TC_INSTRUMENTATION_CONCAT(tc_latency_, __LINE__)(name, TC_INSTRUMENTATION_CONCAT(tc_histogram_, __LINE__), describe, mark)
+
+#else
+
+#define TC_SCOPED_TIMER(name) static_cast<void>(0)
+#define TC_COUNTER_ADD(name, delta) static_cast<void>(0)
+#define TC_SCOPED_LATENCY(name, describe) static_cast<void>(describe)
+#define TC_SCOPED_LATENCY_FROM(name, describe, mark) static_cast<void>(describe), static_cast<void>(mark)
+
+#endif
@@ -378,9 +378,17 @@ namespace json {
 
     void PrintString(const string& s, ostream& out) {
         out << '"';
-        for (const char& ch : s) {
+        // участки без спецсимволов выводятся целиком, а не по одному символу
+        size_t begin = 0;
+        while (begin < s.size()) {
+            const size_t end = s.find_first_of("\n\t\r\"\\"sv, begin);
+            out.write(s.data() + begin, (end == string::npos ? s.size() : end) - begin);
+            if (end == string::npos) {
+                break;
+            }
+            begin = end + 1;
             // Обрабатываем одну из последовательностей
-            switch (ch) {
+            switch (s[end]) {
             case '\n':
                 out << "\\n"sv;
                 continue;
@@ -396,9 +404,6 @@ namespace json {
             case '\\':
                 out << "\\\\"sv;
                 continue;
-            default:
-                out << ch;
-                continue;
             }
         }
         out << '"';
@@ -1,12 +1,57 @@
 #include "json_reader.h"
 
+#include "instrumentation.h"
+
 using namespace std::literals;
 
+namespace {
+
+	// Размеры в байтах выводятся целыми, пока помещаются в int, чтобы не терять точность при выводе double
+	Node::Value MakeBytesValue(uint64_t bytes) {
+		if (bytes <= static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+			return static_cast<int>(bytes);
+		}
+		return static_cast<double>(bytes);
+	}
+
+	// Номер и параметры запроса в одну строку для журнала медленных запросов
+	void DescribeRequest(const Dict& request_map, instrumentation::SlowQuery& query) {
+		if (request_map.count("id"s) && request_map.at("id"s).IsInt()) {
+			query.request_id = request_map.at("id"s).AsInt();
+		}
+		Dict parameters = request_map;
+		parameters.erase("id"s);
+		parameters.erase("type"s);
+		if (parameters.empty()) {
+			return;
+		}
+		std::ostringstream out;
+		Print(Document{ Node{ std::move(parameters) } }, out);
+		// в одну строку: переводы строк с отступами в выводе Print бывают только между элементами
+		bool line_start = false;
+		for (char c : out.str()) {
+			if (c == '\n') {
+				query.parameters += ' ';
+				line_start = true;
+			}
+			else if (!line_start || c != ' ') {
+				query.parameters += c;
+				line_start = false;
+			}
+		}
+	}
+
+}
+
 void JsonReader::MakeCatalogue(catalogue::TransportCatalogue& catalogue) const {
+	TC_SCOPED_TIMER("JsonReader::MakeCatalogue");
 	Array base_requests_arr = document_.GetRoot().AsMap().at("base_requests"s).AsArray();
 	ParseStopCoord(base_requests_arr, catalogue);
 	ParseStopDistances(base_requests_arr, catalogue);
 	ParseBuses(base_requests_arr, catalogue);
+	catalogue.UpdateStopBuses();
+	TC_COUNTER_ADD("catalogue.stops", catalogue.GetStops()->size());
+	TC_COUNTER_ADD("catalogue.buses", catalogue.GetBuses()->size());
 }
 
 RouteSettings JsonReader::GetRouteSettings() const {
@@ -18,6 +63,18 @@ RouteSettings JsonReader::GetRouteSettings() const {
 	if (result.bus_velocity < 1 || result.bus_velocity > 1000 || result.bus_wait_time < 1 || result.bus_wait_time > 1000) {
 		throw std::invalid_argument("Non correct velocity or bus wait time"s);
 	}
+	if (settings.count("walking_velocity"s)) {
+		result.walking_velocity = settings.at("walking_velocity"s).AsDouble();
+	}
+	if (settings.count("walking_stops_count"s)) {
+		result.walking_stops_count = static_cast<size_t>(settings.at("walking_stops_count"s).AsInt());
+	}
+	if (settings.count("route_cache_size"s)) {
+		result.route_cache_size = static_cast<size_t>(settings.at("route_cache_size"s).AsInt());
+	}
+	if (result.walking_velocity <= 0 || result.walking_velocity > 1000) {
+		throw std::invalid_argument("Non correct walking velocity"s);
+	}
 	return result;
 }
 
@@ -52,23 +109,36 @@ void JsonReader::ParseBuses(const Array& base_requests_arr, catalogue::Transport
 		}
 		std::vector<const Stop*> stops;
 
+		// обратный путь некольцевого маршрута не хранится, см. Bus::GetRouteStops
 		for (const Node& stop_node : bus_map.at("stops"s).AsArray()) {
 			stops.emplace_back(catalogue.GetStop(stop_node.AsString()));
 		}
-		if (!bus_map.at("is_roundtrip"s).AsBool()) {
-			bool first = true;
-			for (auto it = bus_map.at("stops"s).AsArray().rbegin(); it != bus_map.at("stops"s).AsArray().rend(); ++it) {
-				if (first) {
-					first = false;
-					continue;
-				}
-				stops.emplace_back(catalogue.GetStop(it->AsString()));
+		const double headway = bus_map.count("headway"s) ? bus_map.at("headway"s).AsDouble() : 0.;
+		const double velocity = bus_map.count("velocity"s) ? bus_map.at("velocity"s).AsDouble() : 0.;
+		if (headway < 0 || velocity < 0 || velocity > 1000) {
+			throw std::invalid_argument("Non correct bus headway or velocity"s);
+		}
+		std::vector<double> departures;
+		if (bus_map.count("departures"s)) {
+			for (const Node& departure : bus_map.at("departures"s).AsArray()) {
+				departures.push_back(departure.AsDouble());
 			}
 		}
-		catalogue.AddBus(bus_map.at("name"s).AsString(), stops, bus_map.at("is_roundtrip"s).AsBool());
+		catalogue.AddBus(bus_map.at("name"s).AsString(), stops, bus_map.at("is_roundtrip"s).AsBool(), headway, velocity, std::move(departures));
 	}
 }
 
+catalogue::detail::Coordinates JsonReader::ParseCoordinates(const Node& point) const {
+	return { point.AsMap().at("latitude"s).AsDouble(), point.AsMap().at("longitude"s).AsDouble() };
+}
+
+RoutePoint JsonReader::ParseRoutePoint(const Node& point) const {
+	if (point.IsMap()) {
+		return ParseCoordinates(point);
+	}
+	return std::string_view(point.AsString());
+}
+
 svg::Color JsonReader::ParseColor(const Node& color) const {
 	using namespace svg;
 	if (color.IsString()) {
@@ -126,24 +196,10 @@ Node JsonReader::MakeStopDict(const catalogue::TransportCatalogue& catalogue, co
 
 		return result.Build();
 	}
-	if (catalogue.RequestStop(catalogue.GetStop(request_map.at("name"s).AsString())) == nullptr) {
-		result.StartDict().
-			Key("buses"s).StartArray().EndArray().
-			Key("request_id").Value(request_map.at("id"s).AsInt()).
-			EndDict();
-
-		return result.Build();
-	}
-	std::vector<std::string> vec;
-	for (BusPtr bus : *catalogue.RequestStop(catalogue.GetStop(request_map.at("name"s).AsString()))) {
-		vec.emplace_back(bus->bus_name);
-	}
-	sort(vec.begin(), vec.end(), [](const std::string& lhs, const std::string& rhs) {
-		return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
-		});
+	// маршруты уже упорядочены по названию в справочнике
 	std::vector<Node> bus_names;
-	for (const std::string& bus_name : vec) {
-		bus_names.emplace_back(Node{ bus_name });
+	for (BusPtr bus : catalogue.RequestStop(catalogue.GetStop(request_map.at("name"s).AsString()))) {
+		bus_names.emplace_back(Node{ std::string(bus->bus_name) });
 	}
 	result.StartDict().
 		Key("buses"s).Value(bus_names).
@@ -153,29 +209,117 @@ Node JsonReader::MakeStopDict(const catalogue::TransportCatalogue& catalogue, co
 	return result.Build();
 }
 
-Node JsonReader::MakeMapDict(const catalogue::TransportCatalogue& catalogue, const MapRenderer& renderer, const json::Node& id) const {
+Node JsonReader::MakeMapDict(const catalogue::TransportCatalogue& catalogue, const MapRenderer& renderer, const json::Dict& request_map) const {
 	using namespace std::literals;
 	Builder result;
 
-	std::ostringstream map_stream;
-	svg::Document map_document;
-	renderer.GetMapDocument(map_document, catalogue);
-	map_document.Render(map_stream);
-	result.StartDict().
-		Key("map"s).Value(map_stream.str()).
-		Key("request_id"s).Value(id.AsInt()).
+	const MapFormat format = ParseMapFormat(request_map);
+	result.StartDict();
+	AddMapPayload(result, *renderer.GetRenderedMap(catalogue, format), format, request_map);
+	result.Key("request_id"s).Value(request_map.at("id"s).AsInt()).
 		EndDict();
 	
 	return result.Build();
 }
 
+MapFormat JsonReader::ParseMapFormat(const json::Dict& request_map) const {
+	if (!request_map.count("format"s) || request_map.at("format"s).AsString() == "svg"s) {
+		return MapFormat::SVG;
+	}
+	if (request_map.at("format"s).AsString() == "binary"s) {
+		return MapFormat::BINARY;
+	}
+	throw std::invalid_argument("Unknown map format"s);
+}
+
+void JsonReader::AddMapPayload(Builder& result, const std::string& map, MapFormat format, const json::Dict& request_map) const {
+	std::optional<std::string> compressed;
+	if (request_map.count("compression"s) && request_map.at("compression"s).AsString() == "gzip"s) {
+		compressed = CompressGzip(map);
+	}
+	else if (request_map.count("compression"s) && request_map.at("compression"s).AsString() != "none"s) {
+		throw std::invalid_argument("Unknown map compression"s);
+	}
+	const std::string& payload = compressed ? *compressed : map;
+
+	if (request_map.count("map_file"s)) {
+		const std::string& file_name = request_map.at("map_file"s).AsString();
+		std::ofstream out(file_name, std::ios::binary);
+		out.write(payload.data(), payload.size());
+		if (!out) {
+			throw std::runtime_error("Can't write map file "s + file_name);
+		}
+		result.Key("map_file"s).Value(file_name);
+		return;
+	}
+
+	if (!compressed && format == MapFormat::SVG) {
+		result.Key("map"s).Value(map);
+	}
+	else {
+		result.Key("map"s).Value(EncodeBase64(payload));
+	}
+}
+
+Node JsonReader::MakeMapTileDict(const catalogue::TransportCatalogue& catalogue, const MapRenderer& renderer, const json::Dict& request_map) const {
+	using namespace std::literals;
+	Builder result;
+
+	MapTile tile;
+	if (request_map.count("bbox"s)) {
+		const Array& corners = request_map.at("bbox"s).AsArray();
+		tile.bbox = std::make_pair(ParseCoordinates(corners.at(0)), ParseCoordinates(corners.at(1)));
+	}
+	else {
+		tile.zoom = request_map.at("zoom"s).AsInt();
+		tile.x = request_map.at("x"s).AsInt();
+		tile.y = request_map.at("y"s).AsInt();
+	}
+	tile.format = ParseMapFormat(request_map);
+
+	const auto map = renderer.GetRenderedTile(catalogue, tile);
+	if (!map) {
+		result.StartDict().
+			Key("request_id"s).Value(request_map.at("id"s).AsInt()).
+			Key("error_message"s).Value("not found"s).
+			EndDict();
+		return result.Build();
+	}
+
+	result.StartDict();
+	AddMapPayload(result, *map, tile.format, request_map);
+	result.Key("request_id"s).Value(request_map.at("id"s).AsInt()).
+		EndDict();
+
+	return result.Build();
+}
+
 Node JsonReader::MakeRouteDict(const TransportRouter& router, const json::Dict& request_map) const {
 	using namespace std::literals;
+
+	const Node& from = request_map.at("from"s);
+	const Node& to = request_map.at("to"s);
+	std::optional<std::pair<Router<RouteTime>::RouteInfo, std::vector<RouteWeight>>> coordinates_route;
+	std::optional<RouteView> route;
+	// каждый конец может быть и остановкой, и координатами
+	if (from.IsMap() || to.IsMap()) {
+		coordinates_route = router.BuildRoute(ParseRoutePoint(from), ParseRoutePoint(to));
+		if (coordinates_route.has_value()) {
+			route = RouteView{ coordinates_route->first.weight, ranges::AsRange(coordinates_route->second) };
+		}
+	}
+	else {
+		route = router.FindRoute(from.AsString(), to.AsString());
+	}
+
+	return MakeRouteDict(route, request_map);
+}
+
+Node JsonReader::MakeRouteDict(const std::optional<RouteView>& route, const json::Dict& request_map) const {
+	using namespace std::literals;
 	Builder result;
 
-	std::optional<std::pair<Router<RouteWeight>::RouteInfo, std::vector<RouteWeight>>> info = router.BuildRoute(request_map.at("from"s).AsString(), request_map.at("to"s).AsString());
-	
-	if (!info.has_value()) {
+	if (!route.has_value()) {
 		result.StartDict().
 			Key("request_id"s).Value(request_map.at("id"s).AsInt()).
 			Key("error_message"s).Value("not found"s).
@@ -185,11 +329,79 @@ Node JsonReader::MakeRouteDict(const TransportRouter& router, const json::Dict&
 
 	result.StartDict().
 		Key("request_id"s).Value(request_map.at("id"s).AsInt()).
-		Key("total_time"s).Value(info.value().first.weight.route_time).
+		Key("total_time"s).Value(route->total_time).
 		Key("items"s).StartArray();
+	AddRouteItems(result, route->items);
+	result.EndArray().EndDict();
+
+	return result.Build();
+}
 
-	for (const RouteWeight& item_weight : info.value().second) {
-		if (item_weight.is_stop) {
+Node JsonReader::MakeTimetableRouteDict(const TimetableRouter& router, const json::Dict& request_map) const {
+	using namespace std::literals;
+	Builder result;
+
+	const double departure_time = request_map.at("departure_time"s).AsDouble();
+	if (request_map.count("max_transfers"s) && request_map.at("max_transfers"s).AsInt() < 0) {
+		result.StartDict().
+			Key("request_id"s).Value(request_map.at("id"s).AsInt()).
+			Key("error_message"s).Value("invalid max_transfers"s).
+			EndDict();
+		return result.Build();
+	}
+	const size_t max_transfers = request_map.count("max_transfers"s)
+		? static_cast<size_t>(request_map.at("max_transfers"s).AsInt())
+		: TimetableRouter::MAX_TRANSFERS;
+	const std::vector<Journey> journeys = router.BuildJourneys(request_map.at("from"s).AsString(), request_map.at("to"s).AsString(), departure_time, max_transfers);
+
+	if (journeys.empty()) {
+		result.StartDict().
+			Key("request_id"s).Value(request_map.at("id"s).AsInt()).
+			Key("error_message"s).Value("not found"s).
+			EndDict();
+		return result.Build();
+	}
+
+	// основной ответ - самое раннее прибытие, оно у варианта с наибольшим числом пересадок
+	const Journey& earliest = journeys.back();
+	result.StartDict().
+		Key("request_id"s).Value(request_map.at("id"s).AsInt()).
+		Key("arrival_time"s).Value(earliest.arrival_time).
+		Key("total_time"s).Value(earliest.arrival_time - departure_time).
+		Key("items"s).StartArray();
+	AddRouteItems(result, ranges::AsRange(earliest.items));
+	result.EndArray();
+
+	if (request_map.count("pareto"s) && request_map.at("pareto"s).AsBool()) {
+		result.Key("journeys"s).StartArray();
+		for (const Journey& journey : journeys) {
+			result.StartDict().
+				Key("arrival_time"s).Value(journey.arrival_time).
+				Key("total_time"s).Value(journey.arrival_time - departure_time).
+				Key("transfers"s).Value(journey.transfers).
+				Key("items"s).StartArray();
+			AddRouteItems(result, ranges::AsRange(journey.items));
+			result.EndArray().EndDict();
+		}
+		result.EndArray();
+	}
+	result.EndDict();
+
+	return result.Build();
+}
+
+void JsonReader::AddRouteItems(Builder& result, const ranges::Range<std::vector<RouteWeight>::const_iterator>& items) const {
+	using namespace std::literals;
+
+	for (const RouteWeight& item_weight : items) {
+		if (item_weight.is_walk) {
+			result.StartDict().Key("type"s).Value("Walk"s);
+			if (!item_weight.name.empty()) {
+				result.Key("stop_name"s).Value(std::string(item_weight.name));
+			}
+			result.Key("time"s).Value(item_weight.route_time).EndDict();
+		}
+		else if (item_weight.is_stop) {
 			result.StartDict().
 				Key("type"s).Value("Wait"s).
 				Key("stop_name"s).Value(std::string(item_weight.name)).
@@ -205,11 +417,126 @@ Node JsonReader::MakeRouteDict(const TransportRouter& router, const json::Dict&
 				EndDict();
 		}
 	}
+}
+
+Node JsonReader::MakeMatrixDict(const TransportRouter& router, const json::Dict& request_map) const {
+	using namespace std::literals;
+	Builder result;
+
+	std::vector<RoutePoint> from;
+	for (const Node& point : request_map.at("from"s).AsArray()) {
+		from.emplace_back(ParseRoutePoint(point));
+	}
+	std::vector<RoutePoint> to;
+	for (const Node& point : request_map.at("to"s).AsArray()) {
+		to.emplace_back(ParseRoutePoint(point));
+	}
+
+	const std::optional<std::vector<std::optional<double>>> times = router.BuildTimeMatrix(from, to);
+	if (!times.has_value()) {
+		result.StartDict().
+			Key("request_id"s).Value(request_map.at("id"s).AsInt()).
+			Key("error_message"s).Value("not found"s).
+			EndDict();
+		return result.Build();
+	}
+
+	result.StartDict().
+		Key("request_id"s).Value(request_map.at("id"s).AsInt()).
+		Key("times"s).StartArray();
+
+	for (size_t row = 0; row < from.size(); ++row) {
+		result.StartArray();
+		for (size_t col = 0; col < to.size(); ++col) {
+			const std::optional<double>& time = (*times)[row * to.size() + col];
+			if (time.has_value()) {
+				result.Value(*time);
+			}
+			else {
+				result.Value(nullptr);
+			}
+		}
+		result.EndArray();
+	}
 	result.EndArray().EndDict();
 
 	return result.Build();
 }
 
+Node JsonReader::MakeIsochroneDict(const TransportRouter& router, const json::Dict& request_map) const {
+	using namespace std::literals;
+	Builder result;
+
+	const std::optional<std::vector<std::pair<StopPtr, double>>> isochrone = router.BuildIsochrone(ParseRoutePoint(request_map.at("from"s)), request_map.at("max_time"s).AsDouble());
+	if (!isochrone.has_value()) {
+		result.StartDict().
+			Key("request_id"s).Value(request_map.at("id"s).AsInt()).
+			Key("error_message"s).Value("not found"s).
+			EndDict();
+		return result.Build();
+	}
+
+	result.StartDict().
+		Key("request_id"s).Value(request_map.at("id"s).AsInt()).
+		Key("stops"s).StartArray();
+
+	for (const auto& [stop, time] : *isochrone) {
+		result.StartDict().
+			Key("stop_name"s).Value(std::string(stop->stop_name)).
+			Key("time"s).Value(time).
+			EndDict();
+	}
+	result.EndArray().EndDict();
+
+	return result.Build();
+}
+
+Node JsonReader::MakeStatsDict(const catalogue::TransportCatalogue& catalogue, const TransportRouter& router, const json::Dict& request_map) const {
+	using namespace std::literals;
+	Builder result;
+
+	const instrumentation::MemoryBreakdown catalogue_usage = catalogue.MemoryUsage();
+	const instrumentation::MemoryBreakdown router_usage = router.MemoryUsage();
+
+	result.StartDict().
+		Key("request_id"s).Value(request_map.at("id"s).AsInt()).
+		Key("total_bytes"s).Value(MakeBytesValue(catalogue_usage.GetTotal() + router_usage.GetTotal())).
+		Key("catalogue"s);
+	AddMemoryUsage(result, catalogue_usage);
+	result.Key("transport_router"s);
+	AddMemoryUsage(result, router_usage);
+
+	const RouteCache::Stats cache_stats = router.GetRouteCacheStats();
+	result.Key("route_cache"s).StartDict().
+		Key("hits"s).Value(MakeBytesValue(cache_stats.hits)).
+		Key("misses"s).Value(MakeBytesValue(cache_stats.misses)).
+		Key("evictions"s).Value(MakeBytesValue(cache_stats.evictions)).
+		Key("size"s).Value(MakeBytesValue(cache_stats.size)).
+		EndDict();
+
+	const instrumentation::AllocationStats allocations = instrumentation::GetAllocationStats();
+	if (allocations.enabled) {
+		result.Key("allocator"s).StartDict().
+			Key("allocations"s).Value(MakeBytesValue(allocations.allocations)).
+			Key("current_bytes"s).Value(MakeBytesValue(allocations.current_bytes)).
+			Key("peak_bytes"s).Value(MakeBytesValue(allocations.peak_bytes)).
+			EndDict();
+	}
+	result.EndDict();
+
+	return result.Build();
+}
+
+void JsonReader::AddMemoryUsage(Builder& result, const instrumentation::MemoryBreakdown& usage) const {
+	using namespace std::literals;
+
+	result.StartDict();
+	for (const auto& [name, bytes] : usage.GetParts()) {
+		result.Key(name).Value(MakeBytesValue(bytes));
+	}
+	result.Key("total"s).Value(MakeBytesValue(usage.GetTotal())).EndDict();
+}
+
 RenderSettings JsonReader::ParseSettings() const {
 	RenderSettings settings;
 	Dict render_settings_map = document_.GetRoot().AsMap().at("render_settings"s).AsMap();
@@ -237,28 +564,144 @@ RenderSettings JsonReader::ParseSettings() const {
 	for (const auto& color : render_settings_map.at("color_palette"s).AsArray()) {
 		settings.color_palette_.emplace_back(ParseColor(color));
 	}
+
+	if (render_settings_map.count("simplify_lines"s)) {
+		settings.simplify_lines_ = render_settings_map.at("simplify_lines"s).AsBool();
+	}
+	if (render_settings_map.count("simplify_tolerance"s)) {
+		settings.simplify_tolerance_ = render_settings_map.at("simplify_tolerance"s).AsDouble();
+	}
+	if (render_settings_map.count("merge_shared_segments"s)) {
+		settings.merge_shared_segments_ = render_settings_map.at("merge_shared_segments"s).AsBool();
+	}
+	if (render_settings_map.count("declutter_labels"s)) {
+		settings.declutter_labels_ = render_settings_map.at("declutter_labels"s).AsBool();
+	}
 	return settings;
 }
 
-json::Document JsonReader::GetRequestDocument(const catalogue::TransportCatalogue& catalogue, const MapRenderer& renderer, const TransportRouter& router) const {
+json::Document JsonReader::GetRequestDocument(const catalogue::TransportCatalogue& catalogue, const MapRenderer& renderer, const TransportRouter& router,
+	const TimetableRouter& timetable_router) const {
 	using namespace std::literals;
 
+	const Array& requests = document_.GetRoot().AsMap().at("stat_requests"s).AsArray();
+
+	std::vector<std::optional<Node>> batched_responses(requests.size());
 	std::vector<Node> res;
-	for (const Node& request_node : document_.GetRoot().AsMap().at("stat_requests"s).AsArray()) {
-		Dict request_map = request_node.AsMap();
-		if (request_map.at("type"s).AsString() == "Bus"s) {
-			BusStat stat = catalogue.RequestBus(request_map.at("name"s).AsString());
-			res.emplace_back(MakeBusDict(stat, request_map));
-		}
-		else if (request_map.at("type"s).AsString() == "Stop"s) {
-			res.emplace_back(MakeStopDict(catalogue, request_map));
+	size_t segment_begin = 0;
+	for (size_t i = 0; i < requests.size(); ++i) {
+		// Stats отвечает о состоянии после всех предыдущих запросов, поэтому группы маршрутов не переходят через него
+		if (i == segment_begin) {
+			size_t segment_end = i;
+			while (segment_end < requests.size() && requests[segment_end].AsMap().at("type"s).AsString() != "Stats"s) {
+				++segment_end;
+			}
+			ProcessRouteBatches(requests, segment_begin, segment_end, router, batched_responses);
+			segment_begin = segment_end + 1;
 		}
-		else if (request_map.at("type"s).AsString() == "Map"s) {
-			res.emplace_back(MakeMapDict(catalogue, renderer, request_map.at("id"s)));
+
+		if (batched_responses[i]) {
+			res.emplace_back(std::move(*batched_responses[i]));
+			continue;
 		}
-		else if (request_map.at("type"s).AsString() == "Route"s) {
-			res.emplace_back(MakeRouteDict(router, request_map));
+		std::optional<Node> response = ProcessRequest(requests[i].AsMap(), catalogue, renderer, router, timetable_router);
+		if (response) {
+			res.emplace_back(std::move(*response));
 		}
 	}
 	return Document{ Node{res} };
 }
+
+void JsonReader::ProcessRouteBatches(const Array& requests, size_t begin, size_t end, const TransportRouter& router,
+	std::vector<std::optional<Node>>& responses) const {
+	using namespace std::literals;
+
+	// Маршруты между остановками группируются по начальной остановке: на группу строится одно дерево
+	// кратчайших путей, а ответы встают на места своих запросов
+	std::vector<std::vector<size_t>> route_batches;
+	std::unordered_map<std::string_view, size_t> batch_by_from;
+	for (size_t i = begin; i < end; ++i) {
+		const Dict& request_map = requests[i].AsMap();
+		// маршруты по расписанию и между координатами считаются отдельно
+		if (request_map.at("type"s).AsString() == "Route"s && !request_map.count("departure_time"s)
+			&& request_map.at("from"s).IsString() && request_map.at("to"s).IsString()) {
+			const auto [it, inserted] = batch_by_from.emplace(request_map.at("from"s).AsString(), route_batches.size());
+			if (inserted) {
+				route_batches.emplace_back();
+			}
+			route_batches[it->second].push_back(i);
+		}
+	}
+
+	for (const std::vector<size_t>& batch : route_batches) {
+		if (batch.size() < MIN_ROUTE_BATCH_SIZE) {
+			continue;
+		}
+		TC_SCOPED_TIMER("JsonReader::RouteBatch");
+		TC_COUNTER_ADD("request.route_batched", batch.size());
+		std::vector<std::string_view> to;
+		for (size_t index : batch) {
+			to.push_back(requests[index].AsMap().at("to"s).AsString());
+		}
+		// задержка запроса группы - от ответа на предыдущий, так что построение дерева достаётся первому
+		instrumentation::LatencyMark mark;
+		router.FindRoutes(requests[batch.front()].AsMap().at("from"s).AsString(), to, [&](size_t i, const std::optional<RouteView>& route) {
+			const Dict& request_map = requests[batch[i]].AsMap();
+			const auto describe = [&request_map](instrumentation::SlowQuery& query) {
+				DescribeRequest(request_map, query);
+			};
+			TC_SCOPED_LATENCY_FROM("request.Route", describe, mark);
+			responses[batch[i]] = MakeRouteDict(route, request_map);
+			});
+	}
+}
+
+std::optional<Node> JsonReader::ProcessRequest(const json::Dict& request_map, const catalogue::TransportCatalogue& catalogue, const MapRenderer& renderer,
+	const TransportRouter& router, const TimetableRouter& timetable_router) const {
+	using namespace std::literals;
+
+	// вызывается только для запросов дольше порога журнала медленных запросов
+	const auto describe = [&request_map](instrumentation::SlowQuery& query) {
+		DescribeRequest(request_map, query);
+	};
+
+	if (request_map.at("type"s).AsString() == "Bus"s) {
+		TC_SCOPED_LATENCY("request.Bus", describe);
+		BusStat stat = catalogue.RequestBus(request_map.at("name"s).AsString());
+		return MakeBusDict(stat, request_map);
+	}
+	else if (request_map.at("type"s).AsString() == "Stop"s) {
+		TC_SCOPED_LATENCY("request.Stop", describe);
+		return MakeStopDict(catalogue, request_map);
+	}
+	else if (request_map.at("type"s).AsString() == "Map"s) {
+		TC_SCOPED_LATENCY("request.Map", describe);
+		return MakeMapDict(catalogue, renderer, request_map);
+	}
+	else if (request_map.at("type"s).AsString() == "MapTile"s) {
+		TC_SCOPED_LATENCY("request.MapTile", describe);
+		return MakeMapTileDict(catalogue, renderer, request_map);
+	}
+	else if (request_map.at("type"s).AsString() == "Route"s && request_map.count("departure_time"s)) {
+		TC_SCOPED_LATENCY("request.Route(timetable)", describe);
+		return MakeTimetableRouteDict(timetable_router, request_map);
+	}
+	else if (request_map.at("type"s).AsString() == "Route"s) {
+		TC_SCOPED_LATENCY("request.Route", describe);
+		return MakeRouteDict(router, request_map);
+	}
+	else if (request_map.at("type"s).AsString() == "Matrix"s) {
+		TC_SCOPED_LATENCY("request.Matrix", describe);
+		return MakeMatrixDict(router, request_map);
+	}
+	else if (request_map.at("type"s).AsString() == "Isochrone"s) {
+		TC_SCOPED_LATENCY("request.Isochrone", describe);
+		return MakeIsochroneDict(router, request_map);
+	}
+	else if (request_map.at("type"s).AsString() == "Stats"s) {
+		TC_SCOPED_LATENCY("request.Stats", describe);
+		return MakeStatsDict(catalogue, router, request_map);
+	}
+	TC_COUNTER_ADD("request.unknown", 1);
+	return std::nullopt;
+}
@@ -1,14 +1,21 @@
 #pragma once
 
 #include "transport_catalogue.h"
+#include "base64.h"
+#include "deflate.h"
 #include "json_builder.h"
 #include "map_renderer.h"
 #include "router.h"
 #include "transport_router.h"
+#include "timetable_router.h"
 
 #include <stdexcept>
+#include <fstream>
 #include <optional>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 using namespace json;
 
@@ -17,7 +24,7 @@ public:
 	JsonReader() = default;
 
 	JsonReader(Document doc_in)
-		: document_(doc_in) {}
+		: document_(std::move(doc_in)) {}
 
 	JsonReader(const Node& node)
 		: document_(Document{ node }) {}
@@ -31,11 +38,23 @@ public:
 
 	RouteSettings GetRouteSettings() const;
 
-	json::Document GetRequestDocument(const catalogue::TransportCatalogue& catalogue, const MapRenderer& renderer, const TransportRouter& route_settings) const;
+	json::Document GetRequestDocument(const catalogue::TransportCatalogue& catalogue, const MapRenderer& renderer, const TransportRouter& route_settings,
+		const TimetableRouter& timetable_router) const;
+
+	// Ответ на один запрос из stat_requests, пусто для запроса неизвестного типа
+	std::optional<Node> ProcessRequest(const json::Dict& request_map, const catalogue::TransportCatalogue& catalogue, const MapRenderer& renderer,
+		const TransportRouter& router, const TimetableRouter& timetable_router) const;
 
 private:
+	// число маршрутов из одной остановки, начиная с которого они считаются одним деревом кратчайших путей
+	static constexpr size_t MIN_ROUTE_BATCH_SIZE = 2;
+
 	Document document_;
 
+	// Ответы на маршруты из одной остановки среди запросов [begin, end), считанные группами, в responses по номеру запроса
+	void ProcessRouteBatches(const Array& requests, size_t begin, size_t end, const TransportRouter& router,
+		std::vector<std::optional<Node>>& responses) const;
+
 	void ParseStopCoord(const Array& base_requests_arr, catalogue::TransportCatalogue& catalogue) const;
 
 	void ParseStopDistances(const Array& base_requests_arr, catalogue::TransportCatalogue& catalogue) const;
@@ -44,12 +63,40 @@ private:
 
 	svg::Color ParseColor(const Node& color) const;
 
+	catalogue::detail::Coordinates ParseCoordinates(const Node& point) const;
+
 	Node MakeBusDict(BusStat stat, const json::Dict& request_map) const;
 
 	Node MakeStopDict(const catalogue::TransportCatalogue& catalogue, const json::Dict& request_map) const;
 
-	Node MakeMapDict(const catalogue::TransportCatalogue& catalogue, const MapRenderer& renderer, const json::Node& id) const;
+	Node MakeMapDict(const catalogue::TransportCatalogue& catalogue, const MapRenderer& renderer, const json::Dict& request_map) const;
+
+	Node MakeMapTileDict(const catalogue::TransportCatalogue& catalogue, const MapRenderer& renderer, const json::Dict& request_map) const;
 	
 	Node MakeRouteDict(const TransportRouter& router, const json::Dict& request_map) const;
 
+	Node MakeRouteDict(const std::optional<RouteView>& route, const json::Dict& request_map) const;
+
+	Node MakeTimetableRouteDict(const TimetableRouter& router, const json::Dict& request_map) const;
+
+	void AddRouteItems(Builder& result, const ranges::Range<std::vector<RouteWeight>::const_iterator>& items) const;
+
+	Node MakeMatrixDict(const TransportRouter& router, const json::Dict& request_map) const;
+
+	Node MakeIsochroneDict(const TransportRouter& router, const json::Dict& request_map) const;
+
+	// Память справочника и маршрутизатора по структурам и, в сборке с TC_TRACK_ALLOCATIONS, счётчики operator new
+	Node MakeStatsDict(const catalogue::TransportCatalogue& catalogue, const TransportRouter& router, const json::Dict& request_map) const;
+
+	void AddMemoryUsage(Builder& result, const instrumentation::MemoryBreakdown& usage) const;
+
+	RoutePoint ParseRoutePoint(const Node& point) const;
+
+	MapFormat ParseMapFormat(const json::Dict& request_map) const;
+
+	// Добавляет карту в ответ. По ключам запроса карта сжимается ("compression": "gzip") и либо
+	// записывается в файл "map_file" с возвратом его имени, либо встраивается строкой:
+	// несжатый SVG как есть, остальное - в base64
+	void AddMapPayload(Builder& result, const std::string& map, MapFormat format, const json::Dict& request_map) const;
+
 };
@@ -1,30 +1,77 @@
+#include <fstream>
 #include <iostream>
 #include <string>
 
+#include "instrumentation.h"
 #include "map_renderer.h"
 #include "json_reader.h"
 #include "request_handler.h"
 #include "transport_router.h"
+#include "timetable_router.h"
 
 using namespace std;
 using namespace catalogue;
 using namespace json;
 
-int main() {
+int main(int argc, char* argv[]) {
+    // --stats печатает замеры этапов в stderr, --stats-file FILE сохраняет их в JSON,
+    // --slow-query-ms MS записывает в журнал запросы дольше MS миллисекунд,
+    // --memory печатает в stderr память справочника и маршрутизатора по структурам
+    bool print_stats = false;
+    bool print_memory = false;
+    string stats_file;
+    for (int i = 1; i < argc; ++i) {
+        const string argument = argv[i];
+        if (argument == "--stats"s) {
+            print_stats = true;
+        }
+        else if (argument == "--memory"s) {
+            print_memory = true;
+        }
+        else if (argument == "--stats-file"s && i + 1 < argc) {
+            stats_file = argv[++i];
+        }
+        else if (argument == "--slow-query-ms"s && i + 1 < argc) {
+            instrumentation::GetSlowQueryLog().SetThreshold(static_cast<uint64_t>(stod(argv[++i]) * 1e6));
+        }
+    }
+
     TransportCatalogue catalogue;
-    JsonReader json_reader(cin);
+    // замер разбора здесь, а не в json::Load: json.cpp собирается и без instrumentation.cpp (tools/network_generator.cpp)
+    Document doc_in = [] {
+        TC_SCOPED_TIMER("json::Load");
+        return Load(cin);
+    }();
+    JsonReader json_reader(std::move(doc_in));
     json_reader.MakeCatalogue(catalogue);
 
     RenderSettings settings = json_reader.ParseSettings();
     MapRenderer renderer(settings);
 
-    TransportRouter transport_router(catalogue, json_reader.GetRouteSettings());
+    const RouteSettings route_settings = json_reader.GetRouteSettings();
+    TransportRouter transport_router(catalogue, route_settings);
+    TimetableRouter timetable_router(catalogue, route_settings);
 
     
     RequestHandler request_handler(catalogue, json_reader, renderer);
     
-    Document doc_out = json_reader.GetRequestDocument(catalogue, renderer, transport_router);
-    Print(doc_out, cout);
+    Document doc_out = json_reader.GetRequestDocument(catalogue, renderer, transport_router, timetable_router);
+    {
+        TC_SCOPED_TIMER("json::Print");
+        Print(doc_out, cout);
+    }
+
+    if (print_stats) {
+        instrumentation::PrintReport(cerr);
+    }
+    if (print_memory) {
+        instrumentation::PrintMemoryUsage(cerr, "catalogue"s, catalogue.MemoryUsage());
+        instrumentation::PrintMemoryUsage(cerr, "transport_router"s, transport_router.MemoryUsage());
+    }
+    if (!stats_file.empty()) {
+        ofstream stats_out(stats_file);
+        instrumentation::PrintJsonReport(stats_out);
+    }
     
     return 0;
 }
@@ -1,5 +1,84 @@
 #include "map_renderer.h"
 
+#include <atomic>
+#include <cmath>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+
+namespace {
+
+    // Делит items на куски по chunk_size и добавляет задачу отрисовки для каждого куска
+    template <typename Item, typename Render>
+    void AddRenderChunks(std::vector<std::function<void(MapWriter&)>>& tasks, const std::vector<Item>& items, size_t chunk_size, Render render) {
+        for (size_t begin = 0; begin < items.size(); begin += chunk_size) {
+            const auto first = items.begin() + begin;
+            const auto last = items.begin() + std::min(begin + chunk_size, items.size());
+            tasks.emplace_back([first, last, render](MapWriter& writer) {
+                render(writer, ranges::Range{ first, last });
+                });
+        }
+    }
+
+    double GetSegmentDistance(svg::Point point, svg::Point from, svg::Point to) {
+        const double dx = to.x - from.x;
+        const double dy = to.y - from.y;
+        const double length = dx * dx + dy * dy;
+        double t = 0.;
+        if (length > 0.) {
+            t = std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length, 0., 1.);
+        }
+        return std::hypot(point.x - from.x - t * dx, point.y - from.y - t * dy);
+    }
+
+    // Douglas-Peucker: оставляет концы и точки, отклоняющиеся от упрощённой линии больше чем на tolerance
+    std::vector<svg::Point> SimplifyPolyline(const std::vector<svg::Point>& points, double tolerance) {
+        if (points.size() <= 2) {
+            return points;
+        }
+        std::vector<bool> keep(points.size(), false);
+        keep.front() = true;
+        keep.back() = true;
+
+        std::vector<std::pair<size_t, size_t>> parts{ { 0, points.size() - 1 } };
+        while (!parts.empty()) {
+            const auto [first, last] = parts.back();
+            parts.pop_back();
+
+            double max_distance = 0.;
+            size_t farthest = first;
+            for (size_t i = first + 1; i < last; ++i) {
+                const double distance = GetSegmentDistance(points[i], points[first], points[last]);
+                if (distance > max_distance) {
+                    max_distance = distance;
+                    farthest = i;
+                }
+            }
+            if (max_distance > tolerance) {
+                keep[farthest] = true;
+                parts.emplace_back(first, farthest);
+                parts.emplace_back(farthest, last);
+            }
+        }
+
+        std::vector<svg::Point> result;
+        for (size_t i = 0; i < points.size(); ++i) {
+            if (keep[i]) {
+                result.push_back(points[i]);
+            }
+        }
+        return result;
+    }
+
+    // Число символов UTF-8 строки, для оценки ширины подписи
+    size_t GetTextLength(std::string_view text) {
+        return std::count_if(text.begin(), text.end(), [](char c) {
+            return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+            });
+    }
+
+}
+
 bool IsZero(double value) {
     return std::abs(value) < EPSILON;
 }
@@ -12,7 +91,9 @@ svg::Point SphereProjector::operator()(catalogue::detail::Coordinates coords) co
 }
 
 MapRenderer::MapRenderer(const RenderSettings& settings)
-    : settings_(settings) {}
+    : settings_(settings) {
+    MakeStyles();
+}
 
 SphereProjector MapRenderer::GetSphereProjector(std::vector<catalogue::detail::Coordinates> geo_coords) const {
     return SphereProjector{ geo_coords.begin(), geo_coords.end(), settings_.width_, settings_.height_, settings_.padding_ };
@@ -22,26 +103,10 @@ int MapRenderer::GetPaletteSize() const {
     return settings_.color_palette_.size();
 }
 
-void MapRenderer::GetMapDocument(svg::Document& document, const catalogue::TransportCatalogue& catalogue) const {
-    std::vector<BusPtr> buses;
-    std::vector<StopPtr> stops;
-
-    for (const auto& [busname, bus] : *catalogue.GetBusMap()) {
-        buses.emplace_back(bus);
-    }
-
-    sort(buses.begin(), buses.end(), [](const BusPtr& lhs, const BusPtr& rhs) {
-        return std::lexicographical_compare(lhs->bus_name.begin(), lhs->bus_name.end(), rhs->bus_name.begin(), rhs->bus_name.end());
-        });
-
-    for (const auto& [stop_ptr, set_bus] : *catalogue.GetBusesByStop()) {
-        if (!set_bus.empty()) {
-            stops.emplace_back(stop_ptr);
-        }
-    }
-    sort(stops.begin(), stops.end(), [](const StopPtr& lhs, const StopPtr& rhs) {
-        return std::lexicographical_compare(lhs->stop_name.begin(), lhs->stop_name.end(), rhs->stop_name.begin(), rhs->stop_name.end());
-        });
+MapRenderer::MapLayout MapRenderer::MakeLayout(const catalogue::TransportCatalogue& catalogue) const {
+    // справочник хранит маршруты и обслуживаемые остановки уже в порядке названий
+    const catalogue::SortedBuses& buses = *catalogue.GetSortedBuses();
+    std::vector<StopPtr> stops(catalogue.GetSortedServedStops()->begin(), catalogue.GetSortedServedStops()->end());
 
     std::vector<catalogue::detail::Coordinates> geo_coords;
     std::vector<std::pair<BusPtr, int>> buses_palette;
@@ -67,147 +132,503 @@ void MapRenderer::GetMapDocument(svg::Document& document, const catalogue::Trans
 
     const SphereProjector proj = GetSphereProjector(geo_coords);
 
-    RenderPolyline(document, buses_palette, proj);
+    // каждая остановка проецируется один раз, слои берут точки по номеру остановки
+    std::vector<svg::Point> points(catalogue.GetStops()->size());
+    for (StopPtr stop : stops) {
+        points[stop->id] = proj(stop->coordinates);
+    }
+
+    return { std::move(buses_palette), std::move(stops), std::move(points), proj };
+}
+
+void MapRenderer::RenderMap(MapWriter& writer, const catalogue::TransportCatalogue& catalogue) const {
+    const MapLayout layout = MakeLayout(catalogue);
+    const auto& [buses_palette, stops, points, proj] = layout;
+
+    size_t objects_count = stops.size();
+    for (const auto& [bus, palette] : buses_palette) {
+        objects_count += bus->GetRouteStops().size();
+    }
+    const size_t threads_count = objects_count < PARALLEL_RENDER_THRESHOLD ? 1 : std::max(std::thread::hardware_concurrency(), 1u);
+    const size_t buses_chunk = std::max<size_t>((buses_palette.size() + threads_count - 1) / threads_count, 1);
+    const size_t stops_chunk = std::max<size_t>((stops.size() + threads_count - 1) / threads_count, 1);
+
+    // слои независимы при общей проекции: режем каждый на куски, рисуем в отдельные буферы и склеиваем по порядку
+    std::vector<RenderTask> tasks;
+    std::vector<MapLine> lines;
+    if (settings_.merge_shared_segments_ || GetSimplifyTolerance() > 0.) {
+        lines = MakeLines(layout);
+        const size_t lines_chunk = std::max<size_t>((lines.size() + threads_count - 1) / threads_count, 1);
+        AddRenderChunks(tasks, lines, lines_chunk, [this](MapWriter& chunk_writer, LinesRange range) {
+            RenderLines(chunk_writer, range);
+            });
+    }
+    else {
+        AddRenderChunks(tasks, buses_palette, buses_chunk, [this, &points](MapWriter& chunk_writer, BusesRange range) {
+            RenderPolyline(chunk_writer, range, points);
+            });
+    }
+    AddRenderChunks(tasks, buses_palette, buses_chunk, [this, &points](MapWriter& chunk_writer, BusesRange range) {
+        RenderBusName(chunk_writer, range, points);
+        });
+    AddRenderChunks(tasks, stops, stops_chunk, [this, &points](MapWriter& chunk_writer, StopsRange range) {
+        RenderStopCircle(chunk_writer, range, points);
+        });
+    const std::vector<bool> labels = settings_.declutter_labels_ ? PlaceStopLabels(layout, catalogue) : std::vector<bool>{};
+    AddRenderChunks(tasks, stops, stops_chunk, [this, &points, &labels](MapWriter& chunk_writer, StopsRange range) {
+        RenderStopName(chunk_writer, range, points, labels);
+        });
+
+    writer.StartDocument();
+    RunRenderTasks(writer, tasks, threads_count);
+    writer.EndDocument();
+}
 
-    RenderBusName(document, buses_palette, proj);
+void MapRenderer::RunRenderTasks(MapWriter& writer, const std::vector<RenderTask>& tasks, size_t threads_count) const {
+    threads_count = std::min(threads_count, tasks.size());
+    if (threads_count <= 1) {
+        for (const RenderTask& task : tasks) {
+            task(writer);
+        }
+        return;
+    }
 
-    RenderStopCircle(document, stops, proj);
+    std::vector<std::string> buffers(tasks.size());
+    std::atomic<size_t> next_task = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threads_count; ++i) {
+        threads.emplace_back([&writer, &tasks, &buffers, &next_task]() {
+            for (size_t task = next_task++; task < tasks.size(); task = next_task++) {
+                const std::unique_ptr<MapWriter> chunk_writer = writer.MakeChunkWriter(buffers[task]);
+                tasks[task](*chunk_writer);
+            }
+            });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (const std::string& buffer : buffers) {
+        writer.AddRaw(buffer);
+    }
+}
 
-    RenderStopName(document, stops, proj);
+std::unique_ptr<MapWriter> MapRenderer::MakeWriter(std::string& buffer, MapFormat format) const {
+    if (format == MapFormat::BINARY) {
+        return std::make_unique<BinaryMapWriter>(buffer, settings_.width_, settings_.height_, palette_colors_);
+    }
+    return std::make_unique<SvgMapWriter>(buffer, svg_style_);
 }
 
-void MapRenderer::SetLine(svg::Polyline& line, int palette) const {
-    using namespace std::literals;
+std::shared_ptr<const std::string> MapRenderer::GetRenderedMap(const catalogue::TransportCatalogue& catalogue, MapFormat format) const {
+    std::lock_guard guard(rendered_map_mutex_);
 
-    line.SetStrokeWidth(settings_.line_width_).
-        SetStrokeColor(settings_.color_palette_[palette]).
-        SetFillColor("none"s).
-        SetStrokeLineCap(svg::StrokeLineCap::ROUND).
-        SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+    RenderedMap& rendered_map = rendered_maps_[format];
+    if (!rendered_map.map || rendered_map.catalogue != &catalogue || rendered_map.version != catalogue.GetVersion()) {
+        std::string map;
+        RenderMap(*MakeWriter(map, format), catalogue);
+        rendered_map = { &catalogue, catalogue.GetVersion(), std::make_shared<const std::string>(std::move(map)) };
+    }
+    return rendered_map.map;
 }
 
-void MapRenderer::SetBusText(svg::Text& bus_name, svg::Text& bus_help, int palette) const {
-    bus_name.SetOffset({ settings_.bus_label_offset_.first, settings_.bus_label_offset_.second })
-        .SetFontSize(settings_.bus_label_font_size_)
-        .SetFillColor(settings_.color_palette_[palette]);
+std::shared_ptr<const std::string> MapRenderer::GetRenderedTile(const catalogue::TransportCatalogue& catalogue, const MapTile& tile) const {
+    std::ostringstream key;
+    key.precision(17);
+    key << static_cast<int>(tile.format) << ' ';
+    if (tile.bbox) {
+        key << tile.bbox->first.lat << ' ' << tile.bbox->first.lng << ' ' << tile.bbox->second.lat << ' ' << tile.bbox->second.lng;
+    }
+    else {
+        if (tile.zoom < 0 || tile.zoom > MAX_TILE_ZOOM || tile.x < 0 || tile.y < 0 || tile.x >= (1 << tile.zoom) || tile.y >= (1 << tile.zoom)) {
+            return nullptr;
+        }
+        key << tile.zoom << '/' << tile.x << '/' << tile.y;
+    }
+
+    std::shared_ptr<const MapLayout> layout;
+    std::shared_ptr<const MapTileIndex> index;
+    {
+        std::lock_guard guard(tiles_mutex_);
+        if (!tiles_cache_.layout || tiles_cache_.catalogue != &catalogue || tiles_cache_.version != catalogue.GetVersion()) {
+            auto new_layout = std::make_shared<const MapLayout>(MakeLayout(catalogue));
+            tiles_cache_.index = std::make_shared<const MapTileIndex>(MakeTileIndex(*new_layout));
+            tiles_cache_.layout = std::move(new_layout);
+            tiles_cache_.catalogue = &catalogue;
+            tiles_cache_.version = catalogue.GetVersion();
+            tiles_cache_.tiles.clear();
+            tiles_cache_.tiles_by_key.clear();
+        }
+        if (const auto it = tiles_cache_.tiles_by_key.find(key.str()); it != tiles_cache_.tiles_by_key.end()) {
+            tiles_cache_.tiles.splice(tiles_cache_.tiles.begin(), tiles_cache_.tiles, it->second);
+            return it->second->second;
+        }
+        layout = tiles_cache_.layout;
+        index = tiles_cache_.index;
+    }
+
+    MapRect view;
+    double scale = 1.;
+    if (tile.bbox) {
+        const svg::Point first = layout->proj(tile.bbox->first);
+        const svg::Point second = layout->proj(tile.bbox->second);
+        view = { std::min(first.x, second.x), std::min(first.y, second.y), std::max(first.x, second.x), std::max(first.y, second.y) };
+
+        const double width = view.max_x - view.min_x;
+        const double height = view.max_y - view.min_y;
+        if (IsZero(width) && IsZero(height)) {
+            return nullptr;
+        }
+        scale = IsZero(width) ? settings_.height_ / height
+            : IsZero(height) ? settings_.width_ / width
+            : std::min(settings_.width_ / width, settings_.height_ / height);
+    }
+    else {
+        scale = static_cast<double>(1 << tile.zoom);
+        const double width = settings_.width_ / scale;
+        const double height = settings_.height_ / scale;
+        view = { tile.x * width, tile.y * height, (tile.x + 1) * width, (tile.y + 1) * height };
+    }
 
-    bus_help.SetOffset({ settings_.bus_label_offset_.first, settings_.bus_label_offset_.second })
-        .SetFontSize(settings_.bus_label_font_size_)
-        .SetFillColor(settings_.underlayer_color_)
-        .SetStrokeColor(settings_.underlayer_color_)
-        .SetStrokeWidth(settings_.underlayer_width_)
-        .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-        .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+    // рисуем без блокировки: раскладка и индекс неизменяемы, а одновременные запросы одного тайла дадут одинаковый результат
+    std::string map;
+    RenderTile(*MakeWriter(map, tile.format), *layout, *index, view, scale);
+    auto rendered = std::make_shared<const std::string>(std::move(map));
+
+    std::lock_guard guard(tiles_mutex_);
+    if (tiles_cache_.index == index && !tiles_cache_.tiles_by_key.count(key.str())) {
+        tiles_cache_.tiles.emplace_front(key.str(), rendered);
+        tiles_cache_.tiles_by_key[key.str()] = tiles_cache_.tiles.begin();
+        if (tiles_cache_.tiles.size() > TILE_CACHE_CAPACITY) {
+            tiles_cache_.tiles_by_key.erase(tiles_cache_.tiles.back().first);
+            tiles_cache_.tiles.pop_back();
+        }
+    }
+    return rendered;
+}
+
+MapTileIndex MapRenderer::MakeTileIndex(const MapLayout& layout) const {
+    size_t objects_count = layout.stops.size();
+    for (const auto& [bus, palette] : layout.buses_palette) {
+        objects_count += bus->GetRouteStops().size();
+    }
+
+    MapTileIndex index(settings_.width_, settings_.height_, objects_count);
+    for (uint32_t bus_index = 0; bus_index < layout.buses_palette.size(); ++bus_index) {
+        const BusPtr bus = layout.buses_palette[bus_index].first;
+        const RouteStops route_stops = bus->GetRouteStops();
+        for (uint32_t i = 0; i + 1 < route_stops.size(); ++i) {
+            index.AddSegment(bus_index, i, layout.points[route_stops[i]->id], layout.points[route_stops[i + 1]->id]);
+        }
+        if (route_stops.size() == 1) {
+            index.AddSegment(bus_index, 0, layout.points[route_stops[0]->id], layout.points[route_stops[0]->id]);
+        }
+        // подписи в тех же точках, что и в RenderBusName
+        index.AddBusLabel(bus_index, 0, layout.points[bus->stops[0]->id]);
+        if (!(bus->is_roundtrip) && bus->GetLastTerminal() != bus->stops[0]) {
+            index.AddBusLabel(bus_index, 1, layout.points[bus->GetLastTerminal()->id]);
+        }
+    }
+    for (uint32_t stop_index = 0; stop_index < layout.stops.size(); ++stop_index) {
+        index.AddStop(stop_index, layout.points[layout.stops[stop_index]->id]);
+    }
+    index.Build();
+    return index;
 }
 
-void MapRenderer::SetStopCircle(svg::Circle& stop_circle) const {
-    stop_circle.SetRadius(settings_.stop_radius_);
+void MapRenderer::RenderTile(MapWriter& writer, const MapLayout& layout, const MapTileIndex& index, const MapRect& view, double scale) const {
+    // объекты с точкой привязки чуть за границей тоже видны: линии и круги своей толщиной, подписи - смещением и текстом
+    const double margin = (settings_.underlayer_width_ + std::max(settings_.line_width_, settings_.stop_radius_)
+        + std::max({ std::abs(settings_.bus_label_offset_.first), std::abs(settings_.bus_label_offset_.second),
+            std::abs(settings_.stop_label_offset_.first), std::abs(settings_.stop_label_offset_.second) })
+        + std::max(settings_.bus_label_font_size_, settings_.stop_label_font_size_)) / scale;
+    const MapRect area = view.Expanded(margin);
+
+    const auto to_tile = [&view, scale](svg::Point point) {
+        return svg::Point{ (point.x - view.min_x) * scale, (point.y - view.min_y) * scale };
+    };
+
+    writer.StartDocument();
+
+    // линии: подряд идущие видимые отрезки маршрута выводятся одной ломаной, близкие точки сливаются
+    std::optional<uint32_t> current_bus;
+    uint32_t last_segment = 0;
+    svg::Point last_written;
+    std::optional<svg::Point> skipped;
+    const auto finish_polyline = [&]() {
+        if (!current_bus) {
+            return;
+        }
+        if (skipped) {
+            writer.AddBusLinePoint(*skipped);
+        }
+        writer.EndBusLine();
+        current_bus.reset();
+    };
+    const auto add_point = [&](svg::Point point) {
+        if (std::hypot(point.x - last_written.x, point.y - last_written.y) < TILE_SIMPLIFY_TOLERANCE) {
+            skipped = point;
+            return;
+        }
+        writer.AddBusLinePoint(point);
+        last_written = point;
+        skipped.reset();
+    };
+
+    for (MapTileIndex::ObjectRef ref : index.FindSegments(area)) {
+        const uint32_t bus_index = MapTileIndex::GetOwner(ref);
+        const uint32_t segment = MapTileIndex::GetIndex(ref);
+        const BusPtr bus = layout.buses_palette[bus_index].first;
+        const RouteStops route_stops = bus->GetRouteStops();
+        const svg::Point from = layout.points[route_stops[segment]->id];
+        const svg::Point to = layout.points[route_stops[std::min<size_t>(segment + 1, route_stops.size() - 1)]->id];
+        if (!area.Intersects({ std::min(from.x, to.x), std::min(from.y, to.y), std::max(from.x, to.x), std::max(from.y, to.y) })) {
+            continue;
+        }
+
+        if (!current_bus || *current_bus != bus_index || last_segment + 1 != segment) {
+            finish_polyline();
+            current_bus = bus_index;
+            writer.StartBusLine(layout.buses_palette[bus_index].second);
+            last_written = to_tile(from);
+            skipped.reset();
+            writer.AddBusLinePoint(last_written);
+        }
+        add_point(to_tile(to));
+        last_segment = segment;
+    }
+    finish_polyline();
+
+    for (MapTileIndex::ObjectRef ref : index.FindBusLabels(area)) {
+        const auto& [bus, palette] = layout.buses_palette[MapTileIndex::GetOwner(ref)];
+        const StopPtr stop = MapTileIndex::GetIndex(ref) == 0 ? bus->stops[0] : bus->GetLastTerminal();
+        if (!area.Contains(layout.points[stop->id])) {
+            continue;
+        }
+        writer.AddBusLabel(to_tile(layout.points[stop->id]), bus->bus_name, palette);
+    }
+
+    std::vector<StopPtr> visible_stops;
+    for (MapTileIndex::ObjectRef ref : index.FindStops(area)) {
+        const StopPtr stop = layout.stops[MapTileIndex::GetOwner(ref)];
+        if (area.Contains(layout.points[stop->id])) {
+            visible_stops.push_back(stop);
+        }
+    }
+    for (StopPtr stop : visible_stops) {
+        writer.AddStopCircle(to_tile(layout.points[stop->id]));
+    }
+    for (StopPtr stop : visible_stops) {
+        writer.AddStopLabel(to_tile(layout.points[stop->id]), stop->stop_name);
+    }
+
+    writer.EndDocument();
 }
 
-void MapRenderer::SetStopText(svg::Text& stop_name, svg::Text& stop_help) const {
-    stop_name.SetOffset({ settings_.stop_label_offset_.first, settings_.stop_label_offset_.second })
-        .SetFontSize(settings_.stop_label_font_size_);
-    stop_help.SetOffset({ settings_.stop_label_offset_.first, settings_.stop_label_offset_.second })
-        .SetFontSize(settings_.stop_label_font_size_)
-        .SetFillColor(settings_.underlayer_color_)
-        .SetStrokeColor(settings_.underlayer_color_)
-        .SetStrokeWidth(settings_.underlayer_width_)
-        .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-        .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+double MapRenderer::GetSimplifyTolerance() const {
+    if (settings_.simplify_tolerance_ > 0.) {
+        return settings_.simplify_tolerance_;
+    }
+    // отклонение меньше половины толщины линии не выходит за её нарисованный контур
+    return settings_.simplify_lines_ ? settings_.line_width_ / 2 : 0.;
 }
 
+std::vector<MapRenderer::MapLine> MapRenderer::MakeLines(const MapLayout& layout) const {
+    std::vector<MapLine> lines;
+    // перегоны, уже нарисованные предыдущими маршрутами, без учёта направления
+    std::unordered_set<uint64_t> drawn_segments;
 
-void MapRenderer::RenderPolyline(svg::Document& doc, const std::vector<std::pair<BusPtr, int>>& buses_palette, const SphereProjector& proj) const {
+    const double tolerance = GetSimplifyTolerance();
+    const auto add_line = [&](std::vector<svg::Point> points, int palette) {
+        if (tolerance > 0.) {
+            points = SimplifyPolyline(points, tolerance);
+        }
+        lines.push_back({ std::move(points), palette });
+    };
 
-    for (const auto& [bus, palette] : buses_palette) {
-        std::vector<catalogue::detail::Coordinates> bus_stops;
-        for (StopPtr stop : bus->stops) {
-            bus_stops.emplace_back(stop->coordinates);
+    for (const auto& [bus, palette] : layout.buses_palette) {
+        const RouteStops route_stops = bus->GetRouteStops();
+        if (!settings_.merge_shared_segments_ || route_stops.size() == 1) {
+            std::vector<svg::Point> points;
+            points.reserve(route_stops.size());
+            for (StopPtr stop : route_stops) {
+                points.push_back(layout.points[stop->id]);
+            }
+            add_line(std::move(points), palette);
+            continue;
+        }
+
+        // маршрут разбивается на участки из ещё не нарисованных перегонов
+        std::vector<svg::Point> points;
+        for (size_t i = 0; i + 1 < route_stops.size(); ++i) {
+            const uint64_t from = route_stops[i]->id;
+            const uint64_t to = route_stops[i + 1]->id;
+            if (from != to && !drawn_segments.insert(std::min(from, to) << 32 | std::max(from, to)).second) {
+                if (points.size() > 1) {
+                    add_line(std::move(points), palette);
+                }
+                points.clear();
+                continue;
+            }
+            if (points.empty()) {
+                points.push_back(layout.points[from]);
+            }
+            points.push_back(layout.points[to]);
         }
+        if (points.size() > 1) {
+            add_line(std::move(points), palette);
+        }
+    }
+    return lines;
+}
+
+std::vector<bool> MapRenderer::PlaceStopLabels(const MapLayout& layout, const catalogue::TransportCatalogue& catalogue) const {
+    // Прямоугольник подписи оценивается по числу символов: ширина символа Verdana около 0.6 размера шрифта
+    const auto get_label_rect = [this](svg::Point position, std::pair<double, double> offset, double font_size, std::string_view text) {
+        const double x = position.x + offset.first;
+        const double y = position.y + offset.second;
+        const double border = settings_.underlayer_width_ / 2.;
+        return MapRect{ x - border, y - font_size - border, x + 0.6 * font_size * GetTextLength(text) + border, y + border };
+    };
 
-        svg::Polyline line;
-        bool bus_empty = true;
+    // размещённые подписи хранятся в сетке, проверка новой подписи смотрит только ячейки под ней
+    const double cell_size = std::max({ settings_.stop_label_font_size_, settings_.bus_label_font_size_, 1. }) * 4.;
+    std::unordered_map<uint64_t, std::vector<MapRect>> placed;
+    const auto for_each_cell = [cell_size](const MapRect& rect, auto callback) {
+        for (int64_t row = static_cast<int64_t>(std::floor(rect.min_y / cell_size)); row <= static_cast<int64_t>(std::floor(rect.max_y / cell_size)); ++row) {
+            for (int64_t col = static_cast<int64_t>(std::floor(rect.min_x / cell_size)); col <= static_cast<int64_t>(std::floor(rect.max_x / cell_size)); ++col) {
+                callback(static_cast<uint64_t>(row) << 32 ^ static_cast<uint32_t>(col));
+            }
+        }
+    };
+    const auto place = [&](const MapRect& rect) {
+        for_each_cell(rect, [&](uint64_t cell) {
+            placed[cell].push_back(rect);
+            });
+    };
+    const auto is_free = [&](const MapRect& rect) {
+        bool free = true;
+        for_each_cell(rect, [&](uint64_t cell) {
+            if (const auto it = placed.find(cell); free && it != placed.end()) {
+                free = std::none_of(it->second.begin(), it->second.end(), [&rect](const MapRect& other) {
+                    return rect.Intersects(other);
+                    });
+            }
+            });
+        return free;
+    };
 
-        for (const catalogue::detail::Coordinates& point : bus_stops) {
-            bus_empty = false;
-            line.AddPoint(proj(point));
+    // названия маршрутов выводятся всегда и занимают место первыми
+    for (const auto& [bus, palette] : layout.buses_palette) {
+        place(get_label_rect(layout.points[bus->stops[0]->id], settings_.bus_label_offset_, settings_.bus_label_font_size_, bus->bus_name));
+        if (!(bus->is_roundtrip) && bus->GetLastTerminal() != bus->stops[0]) {
+            place(get_label_rect(layout.points[bus->GetLastTerminal()->id], settings_.bus_label_offset_,
+                settings_.bus_label_font_size_, bus->bus_name));
         }
+    }
 
-        if (!bus_empty) {
-            SetLine(line, palette);
-            doc.Add(line);
+    // остановки, через которые проходит больше маршрутов, получают подпись раньше
+    std::vector<std::pair<size_t, StopPtr>> stops_by_priority;
+    for (StopPtr stop : layout.stops) {
+        const catalogue::BusesRange stop_buses = catalogue.RequestStop(stop);
+        stops_by_priority.emplace_back(stop_buses.end() - stop_buses.begin(), stop);
+    }
+    std::stable_sort(stops_by_priority.begin(), stops_by_priority.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first > rhs.first;
+        });
+
+    std::vector<bool> labels(layout.points.size(), false);
+    for (const auto& [buses_count, stop] : stops_by_priority) {
+        const MapRect rect = get_label_rect(layout.points[stop->id], settings_.stop_label_offset_, settings_.stop_label_font_size_, stop->stop_name);
+        if (is_free(rect)) {
+            place(rect);
+            labels[stop->id] = true;
         }
-        bus_stops.clear();
     }
+    return labels;
 }
 
-void MapRenderer::RenderBusName(svg::Document& doc, const std::vector<std::pair<BusPtr, int>>& buses_palette, const SphereProjector& proj) const {
+void MapRenderer::MakeStyles() {
     using namespace std::literals;
 
+    for (const svg::Color& color : settings_.color_palette_) {
+        svg_style_.line_styles.push_back(svg::Style().
+            SetStrokeWidth(settings_.line_width_).
+            SetStrokeColor(color).
+            SetFillColor("none"s).
+            SetStrokeLineCap(svg::StrokeLineCap::ROUND).
+            SetStrokeLineJoin(svg::StrokeLineJoin::ROUND).
+            Build());
+        svg_style_.bus_label_styles.push_back(svg::Style().SetFillColor(color).Build());
+
+        std::ostringstream color_out;
+        color_out << color;
+        palette_colors_.push_back(color_out.str());
+    }
+
+    svg_style_.underlayer_style = svg::Style().
+        SetFillColor(settings_.underlayer_color_).
+        SetStrokeColor(settings_.underlayer_color_).
+        SetStrokeWidth(settings_.underlayer_width_).
+        SetStrokeLineCap(svg::StrokeLineCap::ROUND).
+        SetStrokeLineJoin(svg::StrokeLineJoin::ROUND).
+        Build();
+    svg_style_.stop_circle_style = svg::Style().SetFillColor("white"s).Build();
+    svg_style_.stop_label_style = svg::Style().SetFillColor("black"s).Build();
+
+    svg_style_.bus_label_offset = { settings_.bus_label_offset_.first, settings_.bus_label_offset_.second };
+    svg_style_.bus_label_font_size = static_cast<uint32_t>(settings_.bus_label_font_size_);
+    svg_style_.stop_label_offset = { settings_.stop_label_offset_.first, settings_.stop_label_offset_.second };
+    svg_style_.stop_label_font_size = static_cast<uint32_t>(settings_.stop_label_font_size_);
+    svg_style_.stop_radius = settings_.stop_radius_;
+}
+
+void MapRenderer::RenderPolyline(MapWriter& writer, BusesRange buses_palette, const std::vector<svg::Point>& points) const {
     for (const auto& [bus, palette] : buses_palette) {
+        if (bus->stops.empty()) {
+            continue;
+        }
+        writer.StartBusLine(palette);
+        for (StopPtr stop : bus->GetRouteStops()) {
+            writer.AddBusLinePoint(points[stop->id]);
+        }
+        writer.EndBusLine();
+    }
+}
 
-        if (bus->stops.size() > 0) {
-            svg::Text bus_name_first;
-            svg::Text bus_help_first;
-
-            bus_name_first.SetData(bus->bus_name)
-                .SetPosition(proj(bus->stops[0]->coordinates))
-                .SetFontFamily("Verdana"s)
-                .SetFontWeight("bold"s);
-            bus_help_first.SetData(bus->bus_name)
-                .SetPosition(proj(bus->stops[0]->coordinates))
-                .SetFontFamily("Verdana"s)
-                .SetFontWeight("bold"s);
-            SetBusText(bus_name_first, bus_help_first, palette);
-            doc.Add(bus_help_first);
-            doc.Add(bus_name_first);
-
-            if (!(bus->is_roundtrip) && bus->stops[(bus->stops.size() / 2)]->stop_name != bus->stops[0]->stop_name) {
-                svg::Text bus_name_second;
-                svg::Text bus_help_second;
-                bus_name_second.SetData(bus->bus_name)
-                    .SetPosition(proj(bus->stops[(bus->stops.size() / 2)]->coordinates))
-                    .SetFontFamily("Verdana"s)
-                    .SetFontWeight("bold"s);
-                bus_help_second.SetData(bus->bus_name)
-                    .SetPosition(proj(bus->stops[(bus->stops.size() / 2)]->coordinates))
-                    .SetFontFamily("Verdana"s)
-                    .SetFontWeight("bold"s);
-                SetBusText(bus_name_second, bus_help_second, palette);
-                doc.Add(bus_help_second);
-                doc.Add(bus_name_second);
-            }
+void MapRenderer::RenderLines(MapWriter& writer, LinesRange lines) const {
+    for (const MapLine& line : lines) {
+        writer.StartBusLine(line.palette);
+        for (svg::Point point : line.points) {
+            writer.AddBusLinePoint(point);
         }
+        writer.EndBusLine();
     }
 }
 
-void MapRenderer::RenderStopCircle(svg::Document& doc, const std::vector<StopPtr>& stops, const SphereProjector& proj) const {
-    using namespace std::literals;
+void MapRenderer::RenderBusName(MapWriter& writer, BusesRange buses_palette, const std::vector<svg::Point>& points) const {
+    for (const auto& [bus, palette] : buses_palette) {
+        if (bus->stops.empty()) {
+            continue;
+        }
+        writer.AddBusLabel(points[bus->stops[0]->id], bus->bus_name, palette);
 
-    for (StopPtr stop : stops) {
-        svg::Circle stop_circle;
-        stop_circle.SetCenter(proj(stop->coordinates))
-            .SetFillColor("white"s);
-        SetStopCircle(stop_circle);
-        doc.Add(stop_circle);
+        if (!(bus->is_roundtrip) && bus->GetLastTerminal() != bus->stops[0]) {
+            writer.AddBusLabel(points[bus->GetLastTerminal()->id], bus->bus_name, palette);
+        }
     }
 }
 
-void MapRenderer::RenderStopName(svg::Document& doc, const std::vector<StopPtr>& stops, const SphereProjector& proj) const {
-    using namespace std::literals;
+void MapRenderer::RenderStopCircle(MapWriter& writer, StopsRange stops, const std::vector<svg::Point>& points) const {
+    for (StopPtr stop : stops) {
+        writer.AddStopCircle(points[stop->id]);
+    }
+}
 
+void MapRenderer::RenderStopName(MapWriter& writer, StopsRange stops, const std::vector<svg::Point>& points, const std::vector<bool>& labels) const {
     for (StopPtr stop : stops) {
-        svg::Text stop_name;
-        svg::Text stop_help;
-        stop_name.SetPosition(proj(stop->coordinates))
-            .SetFontFamily("Verdana"s)
-            .SetData(stop->stop_name)
-            .SetFillColor("black"s);
-        stop_help.SetPosition(proj(stop->coordinates))
-            .SetFontFamily("Verdana"s)
-            .SetData(stop->stop_name);
-        SetStopText(stop_name, stop_help);
-        doc.Add(stop_help);
-        doc.Add(stop_name);
+        if (!labels.empty() && !labels[stop->id]) {
+            continue;
+        }
+        writer.AddStopLabel(points[stop->id], stop->stop_name);
     }
 }
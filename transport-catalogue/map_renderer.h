@@ -1,12 +1,23 @@
 #pragma once
 #include "domain.h"
+#include "map_tiles.h"
+#include "map_writer.h"
+#include "ranges.h"
 #include "svg.h"
+#include "svg_writer.h"
 #include "transport_catalogue.h"
 
 #include <algorithm>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 inline const double EPSILON = 1e-6;
@@ -95,6 +106,25 @@ struct RenderSettings {
     double underlayer_width_;
 
     std::vector<svg::Color> color_palette_;
+
+    // Упрощение линий маршрутов (Douglas-Peucker). Точки линий спроецированы в пиксели карты, поэтому допуск
+    // задаётся в пикселях при её масштабе: simplify_tolerance_ явно, simplify_lines_ - половина ширины линии
+    bool simplify_lines_ = false;
+    double simplify_tolerance_ = 0.;
+    // общий для нескольких маршрутов перегон между остановками рисуется один раз, цветом первого маршрута
+    bool merge_shared_segments_ = false;
+    // названия остановок, перекрывающие уже размещённые подписи, не выводятся
+    bool declutter_labels_ = false;
+};
+
+// Фрагмент карты: тайл zoom/x/y (карта делится на 2^zoom x 2^zoom частей) либо прямоугольник
+// по координатам двух противоположных углов. Фрагмент выводится в размере всей карты
+struct MapTile {
+    int zoom = 0;
+    int x = 0;
+    int y = 0;
+    std::optional<std::pair<catalogue::detail::Coordinates, catalogue::detail::Coordinates>> bbox;
+    MapFormat format = MapFormat::SVG;
 };
 
 class MapRenderer {
@@ -105,25 +135,107 @@ public:
 
     int GetPaletteSize() const;
 
-    void GetMapDocument(svg::Document& document, const catalogue::TransportCatalogue& catalogue) const;
+    // Записывает документ карты через writer нужного формата
+    void RenderMap(MapWriter& writer, const catalogue::TransportCatalogue& catalogue) const;
+
+    // Writer заданного формата с оформлением из настроек отрисовки
+    std::unique_ptr<MapWriter> MakeWriter(std::string& buffer, MapFormat format) const;
+
+    // Отрисованная карта в заданном формате. Карта строится один раз для каждой версии справочника,
+    // повторные запросы получают ту же строку
+    std::shared_ptr<const std::string> GetRenderedMap(const catalogue::TransportCatalogue& catalogue, MapFormat format = MapFormat::SVG) const;
+
+    // Отрисованный фрагмент карты, содержит только задевающие его объекты.
+    // Последние запрошенные фрагменты хранятся в кэше. Для несуществующего тайла возвращает nullptr
+    std::shared_ptr<const std::string> GetRenderedTile(const catalogue::TransportCatalogue& catalogue, const MapTile& tile) const;
 
 private:
     const RenderSettings settings_;
 
+    // оформление считается один раз при создании
+    SvgMapStyle svg_style_;
+    std::vector<std::string> palette_colors_;
+
+    struct RenderedMap {
+        const catalogue::TransportCatalogue* catalogue = nullptr;
+        uint64_t version = 0;
+        std::shared_ptr<const std::string> map;
+    };
+    mutable std::mutex rendered_map_mutex_;
+    mutable std::map<MapFormat, RenderedMap> rendered_maps_;
+
+    // Маршруты с номерами цветов и остановки в порядке отрисовки и их точки на карте
+    struct MapLayout {
+        std::vector<std::pair<BusPtr, int>> buses_palette;
+        std::vector<StopPtr> stops;
+        // спроецированные координаты остановок по их номеру в справочнике
+        std::vector<svg::Point> points;
+        SphereProjector proj;
+    };
+
+    // Раскладка и пространственный индекс строятся один раз для версии справочника, тайлы - по запросу
+    struct TilesCache {
+        const catalogue::TransportCatalogue* catalogue = nullptr;
+        uint64_t version = 0;
+        std::shared_ptr<const MapLayout> layout;
+        std::shared_ptr<const MapTileIndex> index;
+        // в начале списка - последний использованный тайл
+        std::list<std::pair<std::string, std::shared_ptr<const std::string>>> tiles;
+        std::unordered_map<std::string, decltype(tiles)::iterator> tiles_by_key;
+    };
+    mutable std::mutex tiles_mutex_;
+    mutable TilesCache tiles_cache_;
+
+    using BusesRange = ranges::Range<std::vector<std::pair<BusPtr, int>>::const_iterator>;
+    using StopsRange = ranges::Range<std::vector<StopPtr>::const_iterator>;
+    using RenderTask = std::function<void(MapWriter&)>;
+
+    // Ломаная, оставшаяся от маршрута после объединения перегонов и упрощения
+    struct MapLine {
+        std::vector<svg::Point> points;
+        int palette = 0;
+    };
+    using LinesRange = ranges::Range<std::vector<MapLine>::const_iterator>;
+
+    // начиная с такого числа точек и остановок слои рисуются в нескольких потоках
+    static constexpr size_t PARALLEL_RENDER_THRESHOLD = 1 << 14;
+
+    static constexpr size_t TILE_CACHE_CAPACITY = 256;
+    static constexpr int MAX_TILE_ZOOM = 20;
+    // соседние точки линии ближе этого расстояния (в единицах тайла) сливаются
+    static constexpr double TILE_SIMPLIFY_TOLERANCE = 1.;
+
+    void MakeStyles();
+
+    MapLayout MakeLayout(const catalogue::TransportCatalogue& catalogue) const;
+
+    MapTileIndex MakeTileIndex(const MapLayout& layout) const;
+
+    // Допустимое отклонение при упрощении линий в пикселях карты, 0 - без упрощения
+    double GetSimplifyTolerance() const;
+
+    // Линии маршрутов с учётом merge_shared_segments_ и упрощения
+    std::vector<MapLine> MakeLines(const MapLayout& layout) const;
 
-    void SetLine(svg::Polyline& line, int palette) const;
+    // Отметки по номеру остановки в справочнике: выводить ли её название (см. declutter_labels_)
+    std::vector<bool> PlaceStopLabels(const MapLayout& layout, const catalogue::TransportCatalogue& catalogue) const;
 
-    void SetBusText(svg::Text& bus_name, svg::Text& bus_help, int palette) const;
+    // Выводит объекты из view, растянутого в scale раз, в координатах фрагмента
+    void RenderTile(MapWriter& writer, const MapLayout& layout, const MapTileIndex& index, const MapRect& view, double scale) const;
 
-    void SetStopCircle(svg::Circle& stop_circle) const;
+    // Выполняет задачи отрисовки не более чем в threads_count потоках (при 1 - в текущем)
+    // и дописывает результаты в writer в исходном порядке
+    void RunRenderTasks(MapWriter& writer, const std::vector<RenderTask>& tasks, size_t threads_count) const;
 
-    void SetStopText(svg::Text& stop_name, svg::Text& stop_help) const;
+    // points - спроецированные координаты остановок по их номеру в справочнике
+    void RenderPolyline(MapWriter& writer, BusesRange buses_palette, const std::vector<svg::Point>& points) const;
 
-    void RenderPolyline(svg::Document& doc, const std::vector<std::pair<BusPtr, int>>& buses_palette, const SphereProjector& proj) const;
+    void RenderLines(MapWriter& writer, LinesRange lines) const;
 
-    void RenderBusName(svg::Document& doc, const std::vector<std::pair<BusPtr, int>>& buses_palette, const SphereProjector& proj) const;
+    void RenderBusName(MapWriter& writer, BusesRange buses_palette, const std::vector<svg::Point>& points) const;
 
-    void RenderStopCircle(svg::Document& doc, const std::vector<StopPtr>& stops, const SphereProjector& proj) const;
+    void RenderStopCircle(MapWriter& writer, StopsRange stops, const std::vector<svg::Point>& points) const;
 
-    void RenderStopName(svg::Document& doc, const std::vector<StopPtr>& stops, const SphereProjector& proj) const;
+    // labels - результат PlaceStopLabels, пустой - выводить все названия
+    void RenderStopName(MapWriter& writer, StopsRange stops, const std::vector<svg::Point>& points, const std::vector<bool>& labels) const;
 };
@@ -0,0 +1,129 @@
+#include "map_tiles.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool MapRect::Contains(svg::Point point) const {
+    return point.x >= min_x && point.x <= max_x && point.y >= min_y && point.y <= max_y;
+}
+
+bool MapRect::Intersects(const MapRect& other) const {
+    return other.min_x <= max_x && other.max_x >= min_x && other.min_y <= max_y && other.max_y >= min_y;
+}
+
+MapRect MapRect::Expanded(double margin) const {
+    return { min_x - margin, min_y - margin, max_x + margin, max_y + margin };
+}
+
+MapTileIndex::MapTileIndex(double width, double height, size_t objects_count) {
+    // в среднем несколько объектов на ячейку
+    const size_t side = static_cast<size_t>(std::sqrt(static_cast<double>(objects_count) / 4.)) + 1;
+    cols_ = std::min(side, MAX_CELLS_PER_SIDE);
+    rows_ = cols_;
+    cell_width_ = std::max(width, 1.) / static_cast<double>(cols_);
+    cell_height_ = std::max(height, 1.) / static_cast<double>(rows_);
+}
+
+size_t MapTileIndex::GetCol(double x) const {
+    const double col = std::floor(x / cell_width_);
+    if (col < 0.) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>(col), cols_ - 1);
+}
+
+size_t MapTileIndex::GetRow(double y) const {
+    const double row = std::floor(y / cell_height_);
+    if (row < 0.) {
+        return 0;
+    }
+    return std::min(static_cast<size_t>(row), rows_ - 1);
+}
+
+void MapTileIndex::AddCells(const MapRect& rect, std::vector<uint32_t>& cells) const {
+    for (size_t row = GetRow(rect.min_y); row <= GetRow(rect.max_y); ++row) {
+        for (size_t col = GetCol(rect.min_x); col <= GetCol(rect.max_x); ++col) {
+            cells.push_back(static_cast<uint32_t>(row * cols_ + col));
+        }
+    }
+}
+
+void MapTileIndex::AddSegment(uint32_t bus, uint32_t segment, svg::Point from, svg::Point to) {
+    // длинный отрезок делится на части не длиннее ячейки, чтобы не занимать все ячейки своего прямоугольника
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const size_t parts = static_cast<size_t>(std::max(std::abs(dx) / cell_width_, std::abs(dy) / cell_height_)) + 1;
+
+    std::vector<uint32_t> cells;
+    svg::Point part_from = from;
+    for (size_t i = 1; i <= parts; ++i) {
+        const double t = static_cast<double>(i) / static_cast<double>(parts);
+        const svg::Point part_to = i == parts ? to : svg::Point{ from.x + dx * t, from.y + dy * t };
+        AddCells({ std::min(part_from.x, part_to.x), std::min(part_from.y, part_to.y),
+            std::max(part_from.x, part_to.x), std::max(part_from.y, part_to.y) }, cells);
+        part_from = part_to;
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+    const ObjectRef ref = MakeRef(bus, segment);
+    for (uint32_t cell : cells) {
+        segments_.pending.emplace_back(cell, ref);
+    }
+}
+
+void MapTileIndex::AddBusLabel(uint32_t bus, uint32_t label, svg::Point position) {
+    bus_labels_.pending.emplace_back(static_cast<uint32_t>(GetRow(position.y) * cols_ + GetCol(position.x)), MakeRef(bus, label));
+}
+
+void MapTileIndex::AddStop(uint32_t stop, svg::Point position) {
+    stops_.pending.emplace_back(static_cast<uint32_t>(GetRow(position.y) * cols_ + GetCol(position.x)), MakeRef(stop, 0));
+}
+
+void MapTileIndex::Build() {
+    BuildLayer(segments_);
+    BuildLayer(bus_labels_);
+    BuildLayer(stops_);
+}
+
+void MapTileIndex::BuildLayer(Layer& layer) const {
+    layer.offsets.assign(rows_ * cols_ + 1, 0);
+    for (const auto& [cell, ref] : layer.pending) {
+        ++layer.offsets[cell + 1];
+    }
+    for (size_t i = 1; i < layer.offsets.size(); ++i) {
+        layer.offsets[i] += layer.offsets[i - 1];
+    }
+
+    layer.refs.resize(layer.pending.size());
+    std::vector<size_t> fill(layer.offsets.begin(), layer.offsets.end() - 1);
+    for (const auto& [cell, ref] : layer.pending) {
+        layer.refs[fill[cell]++] = ref;
+    }
+    layer.pending.clear();
+    layer.pending.shrink_to_fit();
+}
+
+std::vector<MapTileIndex::ObjectRef> MapTileIndex::Find(const Layer& layer, const MapRect& rect) const {
+    std::vector<ObjectRef> result;
+    for (size_t row = GetRow(rect.min_y); row <= GetRow(rect.max_y); ++row) {
+        const size_t first_cell = row * cols_ + GetCol(rect.min_x);
+        const size_t last_cell = row * cols_ + GetCol(rect.max_x);
+        result.insert(result.end(), layer.refs.begin() + layer.offsets[first_cell], layer.refs.begin() + layer.offsets[last_cell + 1]);
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+std::vector<MapTileIndex::ObjectRef> MapTileIndex::FindSegments(const MapRect& rect) const {
+    return Find(segments_, rect);
+}
+
+std::vector<MapTileIndex::ObjectRef> MapTileIndex::FindBusLabels(const MapRect& rect) const {
+    return Find(bus_labels_, rect);
+}
+
+std::vector<MapTileIndex::ObjectRef> MapTileIndex::FindStops(const MapRect& rect) const {
+    return Find(stops_, rect);
+}
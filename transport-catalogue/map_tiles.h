@@ -0,0 +1,81 @@
+#pragma once
+
+#include "svg.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Прямоугольник в координатах SVG-карты
+struct MapRect {
+    double min_x = 0.;
+    double min_y = 0.;
+    double max_x = 0.;
+    double max_y = 0.;
+
+    bool Contains(svg::Point point) const;
+    bool Intersects(const MapRect& other) const;
+    MapRect Expanded(double margin) const;
+};
+
+// Равномерная сетка в координатах SVG-карты над отрезками линий, точками подписей маршрутов и остановками.
+// Объекты, задевающие прямоугольник, выбираются за время, пропорциональное их числу, а не размеру карты
+class MapTileIndex {
+public:
+    // Ссылка на объект: номер владельца (маршрута или остановки) и номер объекта у владельца
+    // (отрезка линии или подписи). Упорядочение ссылок совпадает с порядком отрисовки слоёв
+    using ObjectRef = uint64_t;
+
+    static ObjectRef MakeRef(uint32_t owner, uint32_t index) {
+        return (static_cast<uint64_t>(owner) << 32) | index;
+    }
+    static uint32_t GetOwner(ObjectRef ref) {
+        return static_cast<uint32_t>(ref >> 32);
+    }
+    static uint32_t GetIndex(ObjectRef ref) {
+        return static_cast<uint32_t>(ref);
+    }
+
+    // objects_count - ожидаемое число объектов, по нему выбирается размер ячейки
+    MapTileIndex(double width, double height, size_t objects_count);
+
+    void AddSegment(uint32_t bus, uint32_t segment, svg::Point from, svg::Point to);
+    void AddBusLabel(uint32_t bus, uint32_t label, svg::Point position);
+    void AddStop(uint32_t stop, svg::Point position);
+
+    // Раскладывает добавленные объекты по ячейкам, вызывается один раз после всех Add*
+    void Build();
+
+    // Кандидаты в прямоугольнике без повторов, в порядке возрастания ссылок.
+    // Точную проверку пересечения выполняет вызывающий
+    std::vector<ObjectRef> FindSegments(const MapRect& rect) const;
+    std::vector<ObjectRef> FindBusLabels(const MapRect& rect) const;
+    std::vector<ObjectRef> FindStops(const MapRect& rect) const;
+
+private:
+    struct Layer {
+        std::vector<std::pair<uint32_t, ObjectRef>> pending;
+        // объекты ячейки i лежат в [offsets[i], offsets[i + 1])
+        std::vector<size_t> offsets;
+        std::vector<ObjectRef> refs;
+    };
+
+    // максимальное число ячеек по каждой оси
+    static constexpr size_t MAX_CELLS_PER_SIDE = 1024;
+
+    size_t GetCol(double x) const;
+    size_t GetRow(double y) const;
+    // дописывает в cells номера ячеек, задевающих прямоугольник
+    void AddCells(const MapRect& rect, std::vector<uint32_t>& cells) const;
+    void BuildLayer(Layer& layer) const;
+    std::vector<ObjectRef> Find(const Layer& layer, const MapRect& rect) const;
+
+    double cell_width_ = 1.;
+    double cell_height_ = 1.;
+    size_t cols_ = 1;
+    size_t rows_ = 1;
+
+    Layer segments_;
+    Layer bus_labels_;
+    Layer stops_;
+};
@@ -0,0 +1,142 @@
+#include "map_writer.h"
+
+#include <cmath>
+
+using namespace std::literals;
+
+SvgMapWriter::SvgMapWriter(std::string& buffer, const SvgMapStyle& style)
+    : writer_(buffer)
+    , style_(style) {
+}
+
+void SvgMapWriter::StartDocument() {
+    writer_.StartDocument();
+}
+
+void SvgMapWriter::EndDocument() {
+    writer_.EndDocument();
+}
+
+void SvgMapWriter::StartBusLine(int palette) {
+    line_palette_ = palette;
+    writer_.StartPolyline();
+}
+
+void SvgMapWriter::AddBusLinePoint(svg::Point point) {
+    writer_.AddPolylinePoint(point);
+}
+
+void SvgMapWriter::EndBusLine() {
+    writer_.EndPolyline(style_.line_styles[line_palette_]);
+}
+
+void SvgMapWriter::AddBusLabel(svg::Point position, std::string_view bus_name, int palette) {
+    writer_.AddText(position, style_.bus_label_offset, style_.bus_label_font_size, "Verdana"sv, "bold"sv, style_.underlayer_style, bus_name);
+    writer_.AddText(position, style_.bus_label_offset, style_.bus_label_font_size, "Verdana"sv, "bold"sv, style_.bus_label_styles[palette], bus_name);
+}
+
+void SvgMapWriter::AddStopCircle(svg::Point position) {
+    writer_.AddCircle(position, style_.stop_radius, style_.stop_circle_style);
+}
+
+void SvgMapWriter::AddStopLabel(svg::Point position, std::string_view stop_name) {
+    writer_.AddText(position, style_.stop_label_offset, style_.stop_label_font_size, "Verdana"sv, {}, style_.underlayer_style, stop_name);
+    writer_.AddText(position, style_.stop_label_offset, style_.stop_label_font_size, "Verdana"sv, {}, style_.stop_label_style, stop_name);
+}
+
+std::unique_ptr<MapWriter> SvgMapWriter::MakeChunkWriter(std::string& buffer) const {
+    return std::make_unique<SvgMapWriter>(buffer, style_);
+}
+
+void SvgMapWriter::AddRaw(std::string_view fragment) {
+    writer_.AddRaw(fragment);
+}
+
+BinaryMapWriter::BinaryMapWriter(std::string& buffer, double width, double height, const std::vector<std::string>& palette)
+    : out_(buffer)
+    , width_(width)
+    , height_(height)
+    , palette_(palette) {
+}
+
+void BinaryMapWriter::StartDocument() {
+    out_ += "TCM1"sv;
+    AppendPoint({ width_, height_ });
+    AppendVarint(palette_.size());
+    for (const std::string& color : palette_) {
+        AppendString(color);
+    }
+}
+
+void BinaryMapWriter::EndDocument() {
+    out_ += 'E';
+}
+
+void BinaryMapWriter::StartBusLine(int palette) {
+    line_palette_ = palette;
+    line_points_.clear();
+}
+
+void BinaryMapWriter::AddBusLinePoint(svg::Point point) {
+    line_points_.emplace_back(std::llround(point.x * COORDINATE_SCALE), std::llround(point.y * COORDINATE_SCALE));
+}
+
+void BinaryMapWriter::EndBusLine() {
+    out_ += 'L';
+    AppendVarint(line_palette_);
+    AppendVarint(line_points_.size());
+    std::pair<int64_t, int64_t> previous{ 0, 0 };
+    for (const auto& point : line_points_) {
+        AppendSigned(point.first - previous.first);
+        AppendSigned(point.second - previous.second);
+        previous = point;
+    }
+}
+
+void BinaryMapWriter::AddBusLabel(svg::Point position, std::string_view bus_name, int palette) {
+    out_ += 'B';
+    AppendVarint(palette);
+    AppendPoint(position);
+    AppendString(bus_name);
+}
+
+void BinaryMapWriter::AddStopCircle(svg::Point position) {
+    out_ += 'C';
+    AppendPoint(position);
+}
+
+void BinaryMapWriter::AddStopLabel(svg::Point position, std::string_view stop_name) {
+    out_ += 'S';
+    AppendPoint(position);
+    AppendString(stop_name);
+}
+
+std::unique_ptr<MapWriter> BinaryMapWriter::MakeChunkWriter(std::string& buffer) const {
+    return std::make_unique<BinaryMapWriter>(buffer, width_, height_, palette_);
+}
+
+void BinaryMapWriter::AddRaw(std::string_view fragment) {
+    out_ += fragment;
+}
+
+void BinaryMapWriter::AppendVarint(uint64_t value) {
+    while (value >= 0x80) {
+        out_ += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out_ += static_cast<char>(value);
+}
+
+void BinaryMapWriter::AppendSigned(int64_t value) {
+    AppendVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void BinaryMapWriter::AppendPoint(svg::Point point) {
+    AppendSigned(std::llround(point.x * COORDINATE_SCALE));
+    AppendSigned(std::llround(point.y * COORDINATE_SCALE));
+}
+
+void BinaryMapWriter::AppendString(std::string_view text) {
+    AppendVarint(text.size());
+    out_ += text;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "svg.h"
+#include "svg_writer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Формат вывода карты
+enum class MapFormat {
+    SVG,
+    // компактное двоичное представление, см. BinaryMapWriter
+    BINARY,
+};
+
+// Приёмник объектов карты. Порядок слоёв и номера цветов палитры задаёт MapRenderer,
+// а как объекты выглядят в выводе - реализация
+class MapWriter {
+public:
+    virtual ~MapWriter() = default;
+
+    virtual void StartDocument() = 0;
+    virtual void EndDocument() = 0;
+
+    virtual void StartBusLine(int palette) = 0;
+    virtual void AddBusLinePoint(svg::Point point) = 0;
+    virtual void EndBusLine() = 0;
+
+    virtual void AddBusLabel(svg::Point position, std::string_view bus_name, int palette) = 0;
+    virtual void AddStopCircle(svg::Point position) = 0;
+    virtual void AddStopLabel(svg::Point position, std::string_view stop_name) = 0;
+
+    // Writer того же формата для части документа, которую потом допишут через AddRaw
+    virtual std::unique_ptr<MapWriter> MakeChunkWriter(std::string& buffer) const = 0;
+    virtual void AddRaw(std::string_view fragment) = 0;
+};
+
+// Готовые атрибуты SVG-объектов карты, считаются один раз по настройкам отрисовки
+struct SvgMapStyle {
+    // линии и названия маршрутов - для каждого цвета палитры
+    std::vector<std::string> line_styles;
+    std::vector<std::string> bus_label_styles;
+    std::string underlayer_style;
+    std::string stop_circle_style;
+    std::string stop_label_style;
+
+    svg::Point bus_label_offset;
+    uint32_t bus_label_font_size = 0;
+    svg::Point stop_label_offset;
+    uint32_t stop_label_font_size = 0;
+    double stop_radius = 0.;
+};
+
+class SvgMapWriter final : public MapWriter {
+public:
+    SvgMapWriter(std::string& buffer, const SvgMapStyle& style);
+
+    void StartDocument() override;
+    void EndDocument() override;
+
+    void StartBusLine(int palette) override;
+    void AddBusLinePoint(svg::Point point) override;
+    void EndBusLine() override;
+
+    void AddBusLabel(svg::Point position, std::string_view bus_name, int palette) override;
+    void AddStopCircle(svg::Point position) override;
+    void AddStopLabel(svg::Point position, std::string_view stop_name) override;
+
+    std::unique_ptr<MapWriter> MakeChunkWriter(std::string& buffer) const override;
+    void AddRaw(std::string_view fragment) override;
+
+private:
+    svg::StreamWriter writer_;
+    const SvgMapStyle& style_;
+    int line_palette_ = 0;
+};
+
+// Двоичный формат: заголовок и затем записи в порядке слоёв, поэтому части документа можно склеивать.
+//   заголовок: "TCM1", ширина и высота, число цветов и сами цвета в виде строк SVG
+//   'L' палитра, число точек, точки (первая - от начала координат, остальные - от предыдущей)
+//   'B' палитра, точка, название маршрута
+//   'C' точка
+//   'S' точка, название остановки
+//   'E' конец документа
+// Числа записываются как varint (целые со знаком - в zigzag), координаты - в сотых долях единицы карты,
+// строки - длиной и байтами UTF-8
+class BinaryMapWriter final : public MapWriter {
+public:
+    // Точность координат: единиц на одну единицу карты
+    static constexpr double COORDINATE_SCALE = 100.;
+
+    BinaryMapWriter(std::string& buffer, double width, double height, const std::vector<std::string>& palette);
+
+    void StartDocument() override;
+    void EndDocument() override;
+
+    void StartBusLine(int palette) override;
+    void AddBusLinePoint(svg::Point point) override;
+    void EndBusLine() override;
+
+    void AddBusLabel(svg::Point position, std::string_view bus_name, int palette) override;
+    void AddStopCircle(svg::Point position) override;
+    void AddStopLabel(svg::Point position, std::string_view stop_name) override;
+
+    std::unique_ptr<MapWriter> MakeChunkWriter(std::string& buffer) const override;
+    void AddRaw(std::string_view fragment) override;
+
+private:
+    void AppendVarint(uint64_t value);
+    void AppendSigned(int64_t value);
+    void AppendPoint(svg::Point point);
+    void AppendString(std::string_view text);
+
+    std::string& out_;
+    double width_;
+    double height_;
+    const std::vector<std::string>& palette_;
+
+    // точки текущей линии копятся, чтобы записать их число перед ними
+    int line_palette_ = 0;
+    std::vector<std::pair<int64_t, int64_t>> line_points_;
+};
@@ -0,0 +1,142 @@
+#include "memory_usage.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <ostream>
+
+namespace instrumentation {
+
+    namespace {
+
+        std::atomic<uint64_t> allocations_count{ 0 };
+        std::atomic<uint64_t> current_bytes{ 0 };
+        std::atomic<uint64_t> peak_bytes{ 0 };
+
+    }
+
+    void MemoryBreakdown::Add(std::string name, size_t bytes) {
+        parts_.emplace_back(std::move(name), bytes);
+    }
+
+    void MemoryBreakdown::Add(std::string_view prefix, const MemoryBreakdown& nested) {
+        for (const auto& [name, bytes] : nested.parts_) {
+            parts_.emplace_back(std::string(prefix) + '.' + name, bytes);
+        }
+    }
+
+    const std::vector<std::pair<std::string, size_t>>& MemoryBreakdown::GetParts() const {
+        return parts_;
+    }
+
+    size_t MemoryBreakdown::GetTotal() const {
+        size_t total = 0;
+        for (const auto& [name, bytes] : parts_) {
+            total += bytes;
+        }
+        return total;
+    }
+
+    AllocationStats GetAllocationStats() {
+        AllocationStats stats;
+#ifdef TC_TRACK_ALLOCATIONS
+        stats.enabled = true;
+#endif
+        stats.allocations = allocations_count.load(std::memory_order_relaxed);
+        stats.current_bytes = current_bytes.load(std::memory_order_relaxed);
+        stats.peak_bytes = peak_bytes.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void PrintMemoryUsage(std::ostream& out, std::string_view name, const MemoryBreakdown& usage) {
+        out << name << ": " << std::fixed << std::setprecision(1) << static_cast<double>(usage.GetTotal()) / (1 << 20) << " MB\n";
+        for (const auto& [part, bytes] : usage.GetParts()) {
+            out << "  " << std::left << std::setw(38) << part << std::right << std::setw(14) << bytes << '\n';
+        }
+        out << std::defaultfloat;
+    }
+
+}  // namespace instrumentation
+
+#ifdef TC_TRACK_ALLOCATIONS
+
+// Перед каждым блоком хранится его размер, чтобы operator delete без размера мог вычесть его из текущего объёма.
+// Заголовок в 16 байт сохраняет выравнивание, которое гарантирует malloc
+namespace {
+
+    const size_t ALLOCATION_HEADER_SIZE = 16;
+
+    void* TrackedAllocate(size_t size) {
+        using namespace instrumentation;
+        void* block = std::malloc(size + ALLOCATION_HEADER_SIZE);
+        if (block == nullptr) {
+            return nullptr;
+        }
+        *static_cast<size_t*>(block) = size;
+        allocations_count.fetch_add(1, std::memory_order_relaxed);
+        const uint64_t current = current_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+        uint64_t peak = peak_bytes.load(std::memory_order_relaxed);
+        while (peak < current && !peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+        }
+        return static_cast<char*>(block) + ALLOCATION_HEADER_SIZE;
+    }
+
+    void TrackedFree(void* ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        void* block = static_cast<char*>(ptr) - ALLOCATION_HEADER_SIZE;
+        instrumentation::current_bytes.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+        std::free(block);
+    }
+
+}
+
+void* operator new(size_t size) {
+    if (void* ptr = TrackedAllocate(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    if (void* ptr = TrackedAllocate(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return TrackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return TrackedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    TrackedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    TrackedFree(ptr);
+}
+
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace instrumentation {
+
+    // Занятая структурой память по частям, в байтах. Считается по ёмкостям контейнеров,
+    // накладные расходы узлов и блоков оцениваются по типичной реализации стандартной библиотеки
+    class MemoryBreakdown {
+    public:
+        void Add(std::string name, size_t bytes);
+        // Части вложенной структуры с префиксом "prefix."
+        void Add(std::string_view prefix, const MemoryBreakdown& nested);
+
+        const std::vector<std::pair<std::string, size_t>>& GetParts() const;
+        size_t GetTotal() const;
+
+    private:
+        std::vector<std::pair<std::string, size_t>> parts_;
+    };
+
+    // Счётчики глобальных operator new/delete. Считаются только в сборке с TC_TRACK_ALLOCATIONS
+    struct AllocationStats {
+        bool enabled = false;
+        uint64_t allocations = 0;
+        uint64_t current_bytes = 0;
+        uint64_t peak_bytes = 0;
+    };
+
+    AllocationStats GetAllocationStats();
+
+    void PrintMemoryUsage(std::ostream& out, std::string_view name, const MemoryBreakdown& usage);
+
+    // Куча строки; короткие строки хранятся внутри объекта и памяти не занимают
+    inline size_t GetHeapMemory(const std::string& text) {
+        const char* data = text.data();
+        const char* object = reinterpret_cast<const char*>(&text);
+        if (data >= object && data < object + sizeof(text)) {
+            return 0;
+        }
+        return text.capacity() + 1;
+    }
+
+    template <typename T, typename Allocator>
+    size_t GetHeapMemory(const std::vector<T, Allocator>& values) {
+        return values.capacity() * sizeof(T);
+    }
+
+    // Блоки по 512 байт и массив указателей на них
+    template <typename T, typename Allocator>
+    size_t GetHeapMemory(const std::deque<T, Allocator>& values) {
+        const size_t block_size = sizeof(T) < 512 ? 512 / sizeof(T) : 1;
+        const size_t blocks_count = values.size() / block_size + 1;
+        return blocks_count * block_size * sizeof(T) + (blocks_count + 8) * sizeof(void*);
+    }
+
+    // Массив корзин и узлы с указателем на следующий и сохранённым хэшем
+    template <typename Key, typename Value, typename Hash, typename Equal, typename Allocator>
+    size_t GetHeapMemory(const std::unordered_map<Key, Value, Hash, Equal, Allocator>& values) {
+        return values.bucket_count() * sizeof(void*) + values.size() * (sizeof(std::pair<const Key, Value>) + 2 * sizeof(void*));
+    }
+
+    // Узлы красно-чёрного дерева: цвет и три указателя
+    template <typename Key, typename Compare, typename Allocator>
+    size_t GetHeapMemory(const std::set<Key, Compare, Allocator>& values) {
+        return values.size() * (sizeof(Key) + 4 * sizeof(void*));
+    }
+
+    template <typename Key, typename Value, typename Compare, typename Allocator>
+    size_t GetHeapMemory(const std::map<Key, Value, Compare, Allocator>& values) {
+        return values.size() * (sizeof(std::pair<const Key, Value>) + 4 * sizeof(void*));
+    }
+
+    // Вектор векторов вместе с содержимым вложенных
+    template <typename T, typename Allocator, typename OuterAllocator>
+    size_t GetHeapMemory(const std::vector<std::vector<T, Allocator>, OuterAllocator>& values) {
+        size_t bytes = values.capacity() * sizeof(std::vector<T, Allocator>);
+        for (const auto& nested : values) {
+            bytes += GetHeapMemory(nested);
+        }
+        return bytes;
+    }
+
+}  // namespace instrumentation
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "graph.h"
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Рабочее пространство поисков по графу: массивы весов, предыдущих рёбер и посещённых вершин размера V
+    // и буферы для результата. Массивы не очищаются между поисками: вершина считается затронутой
+    // текущим поиском, только если её метка совпадает с номером поиска. Поэтому новый поиск стоит O(1),
+    // а после прогрева запросы не выделяют память
+    template <typename Weight>
+    class QueryWorkspace {
+    public:
+        // Своё рабочее пространство у каждого потока
+        static QueryWorkspace& ForCurrentThread() {
+            static thread_local QueryWorkspace workspace;
+            return workspace;
+        }
+
+        // Начинает новый поиск по графу из vertex_count вершин
+        void Prepare(size_t vertex_count) {
+            if (weights_.size() < vertex_count) {
+                weights_.resize(vertex_count);
+                prev_edges_.resize(vertex_count);
+                reached_stamps_.resize(vertex_count, 0);
+                settled_stamps_.resize(vertex_count, 0);
+            }
+            if (stamp_ == std::numeric_limits<uint32_t>::max()) {
+                std::fill(reached_stamps_.begin(), reached_stamps_.end(), 0);
+                std::fill(settled_stamps_.begin(), settled_stamps_.end(), 0);
+                stamp_ = 0;
+            }
+            ++stamp_;
+            heap_.clear();
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return reached_stamps_[vertex] == stamp_;
+        }
+
+        const Weight& GetWeight(VertexId vertex) const {
+            return weights_[vertex];
+        }
+
+        EdgeId GetPrevEdge(VertexId vertex) const {
+            return prev_edges_[vertex];
+        }
+
+        void SetWeight(VertexId vertex, const Weight& weight, EdgeId prev_edge = NO_EDGE) {
+            weights_[vertex] = weight;
+            prev_edges_[vertex] = prev_edge;
+            reached_stamps_[vertex] = stamp_;
+        }
+
+        bool IsSettled(VertexId vertex) const {
+            return settled_stamps_[vertex] == stamp_;
+        }
+
+        void Settle(VertexId vertex) {
+            settled_stamps_[vertex] = stamp_;
+        }
+
+        std::vector<std::pair<Weight, VertexId>>& GetHeap() {
+            return heap_;
+        }
+
+        // Буфер результата запроса, переиспользуется от запроса к запросу
+        std::vector<EdgeId>& GetEdges() {
+            return edges_;
+        }
+
+        instrumentation::MemoryBreakdown MemoryUsage() const {
+            using instrumentation::GetHeapMemory;
+
+            instrumentation::MemoryBreakdown usage;
+            usage.Add("vertices", GetHeapMemory(weights_) + GetHeapMemory(prev_edges_) + GetHeapMemory(reached_stamps_)
+                + GetHeapMemory(settled_stamps_));
+            usage.Add("heap", GetHeapMemory(heap_));
+            usage.Add("results", GetHeapMemory(edges_));
+            return usage;
+        }
+
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    private:
+        std::vector<Weight> weights_;
+        std::vector<EdgeId> prev_edges_;
+        std::vector<uint32_t> reached_stamps_;
+        std::vector<uint32_t> settled_stamps_;
+        uint32_t stamp_ = 0;
+
+        std::vector<std::pair<Weight, VertexId>> heap_;
+        std::vector<EdgeId> edges_;
+    };
+
+}  // namespace graph
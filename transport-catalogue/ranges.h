@@ -12,6 +12,7 @@ namespace ranges {
     public:
         using ValueType = typename std::iterator_traits<It>::value_type;
 
+        Range() = default;
         Range(It begin, It end)
             : begin_(begin)
             , end_(end) {
@@ -23,9 +24,20 @@ namespace ranges {
             return end_;
         }
 
+        size_t size() const {
+            return static_cast<size_t>(std::distance(begin_, end_));
+        }
+        bool empty() const {
+            return begin_ == end_;
+        }
+        // Только для итераторов произвольного доступа
+        decltype(auto) operator[](size_t index) const {
+            return begin_[index];
+        }
+
     private:
-        It begin_;
-        It end_;
+        It begin_{};
+        It end_{};
     };
 
     template <typename C>
@@ -7,12 +7,10 @@ std::optional<BusStat> RequestHandler::GetBusStat(const std::string_view& bus_na
     return db_.RequestBus(bus_name);
 }
 
-const std::unordered_set<const Bus*>* RequestHandler::GetBusesByStop(const std::string_view& stop_name) const {
+BusesRange RequestHandler::GetBusesByStop(const std::string_view& stop_name) const {
     return db_.RequestStop(db_.GetStop(stop_name));
 }
 
 void RequestHandler::RenderMap(std::ostream& out) const {
-    svg::Document document;
-    renderer_.GetMapDocument(document, db_);
-    document.Render(out);
+    out << *renderer_.GetRenderedMap(db_);
 }
@@ -20,7 +20,7 @@ public:
     std::optional<BusStat> GetBusStat(const std::string_view& bus_name) const;
 
     // Возвращает маршруты, проходящие через
-    const std::unordered_set<const Bus*>* GetBusesByStop(const std::string_view& stop_name) const;
+    BusesRange GetBusesByStop(const std::string_view& stop_name) const;
 
     void RenderMap(std::ostream& out) const;
 
@@ -0,0 +1,93 @@
+#include "route_cache.h"
+
+#include "memory_usage.h"
+
+RouteCache::RouteCache(size_t capacity)
+	: shard_capacity_((capacity + SHARDS_COUNT - 1) / SHARDS_COUNT) {
+}
+
+bool RouteCache::IsEnabled() const {
+	return shard_capacity_ > 0;
+}
+
+bool RouteCache::Find(graph::VertexId from, graph::VertexId to, uint64_t version, std::optional<double>& total_time, std::vector<graph::EdgeId>& edges) {
+	const uint64_t key = MakeKey(from, to);
+	Shard& shard = GetShard(key);
+
+	std::lock_guard guard(shard.mutex);
+	CheckVersion(shard, version);
+	const auto it = shard.routes_by_key.find(key);
+	if (it == shard.routes_by_key.end()) {
+		misses_.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	shard.routes.splice(shard.routes.begin(), shard.routes, it->second);
+	total_time = it->second->second.total_time;
+	edges.assign(it->second->second.edges.begin(), it->second->second.edges.end());
+	hits_.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void RouteCache::Insert(graph::VertexId from, graph::VertexId to, uint64_t version, std::optional<double> total_time, const std::vector<graph::EdgeId>& edges) {
+	const uint64_t key = MakeKey(from, to);
+	Shard& shard = GetShard(key);
+
+	std::lock_guard guard(shard.mutex);
+	CheckVersion(shard, version);
+	// пару мог уже добавить другой поток
+	if (shard.routes_by_key.count(key)) {
+		return;
+	}
+
+	shard.routes.emplace_front(key, CachedRoute{ total_time, total_time ? edges : std::vector<graph::EdgeId>{} });
+	shard.routes_by_key[key] = shard.routes.begin();
+	if (shard.routes.size() > shard_capacity_) {
+		shard.routes_by_key.erase(shard.routes.back().first);
+		shard.routes.pop_back();
+		evictions_.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+RouteCache::Stats RouteCache::GetStats() const {
+	Stats stats;
+	stats.hits = hits_.load(std::memory_order_relaxed);
+	stats.misses = misses_.load(std::memory_order_relaxed);
+	stats.evictions = evictions_.load(std::memory_order_relaxed);
+	for (const Shard& shard : shards_) {
+		std::lock_guard guard(shard.mutex);
+		stats.size += shard.routes.size();
+	}
+	return stats;
+}
+
+size_t RouteCache::MemoryUsage() const {
+	size_t result = 0;
+	for (const Shard& shard : shards_) {
+		std::lock_guard guard(shard.mutex);
+		// узел списка: запись и два указателя
+		result += shard.routes.size() * (sizeof(std::pair<uint64_t, CachedRoute>) + 2 * sizeof(void*));
+		for (const auto& [key, route] : shard.routes) {
+			result += instrumentation::GetHeapMemory(route.edges);
+		}
+		result += instrumentation::GetHeapMemory(shard.routes_by_key);
+	}
+	return result;
+}
+
+uint64_t RouteCache::MakeKey(graph::VertexId from, graph::VertexId to) {
+	return static_cast<uint64_t>(from) << 32 | static_cast<uint64_t>(to);
+}
+
+RouteCache::Shard& RouteCache::GetShard(uint64_t key) {
+	// перемешиваем биты, чтобы соседние пары попадали в разные сегменты
+	return shards_[(key * 0x9E3779B97F4A7C15ull >> 32) % SHARDS_COUNT];
+}
+
+void RouteCache::CheckVersion(Shard& shard, uint64_t version) {
+	if (shard.version != version) {
+		shard.routes.clear();
+		shard.routes_by_key.clear();
+		shard.version = version;
+	}
+}
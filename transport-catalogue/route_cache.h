@@ -0,0 +1,67 @@
+#pragma once
+
+#include "graph.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Кэш маршрутов между остановками: для пары вершин хранится время в пути и рёбра найденного пути,
+// элементы маршрута по ним восстанавливает TransportRouter. Записи распределены по сегментам
+// со своей блокировкой, в каждом сегменте вытесняются давно не использованные.
+// Записи относятся к версии справочника: при её смене сегмент очищается при первом обращении
+class RouteCache {
+public:
+	struct Stats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		size_t size = 0;
+	};
+
+	// capacity - общее число записей во всех сегментах, 0 отключает кэш
+	explicit RouteCache(size_t capacity);
+
+	bool IsEnabled() const;
+
+	// Копирует найденный для версии version маршрут в total_time и edges (nullopt - маршрута нет).
+	// Возвращает false, если пары в кэше нет
+	bool Find(graph::VertexId from, graph::VertexId to, uint64_t version, std::optional<double>& total_time, std::vector<graph::EdgeId>& edges);
+	void Insert(graph::VertexId from, graph::VertexId to, uint64_t version, std::optional<double> total_time, const std::vector<graph::EdgeId>& edges);
+
+	Stats GetStats() const;
+	size_t MemoryUsage() const;
+
+private:
+	static constexpr size_t SHARDS_COUNT = 16;
+
+	struct CachedRoute {
+		std::optional<double> total_time;
+		std::vector<graph::EdgeId> edges;
+	};
+
+	struct Shard {
+		mutable std::mutex mutex;
+		uint64_t version = 0;
+		// в начале списка - последняя использованная запись
+		std::list<std::pair<uint64_t, CachedRoute>> routes;
+		std::unordered_map<uint64_t, decltype(routes)::iterator> routes_by_key;
+	};
+
+	static uint64_t MakeKey(graph::VertexId from, graph::VertexId to);
+	Shard& GetShard(uint64_t key);
+	// Сбрасывает записи другой версии справочника, вызывается под блокировкой сегмента
+	static void CheckVersion(Shard& shard, uint64_t version);
+
+	size_t shard_capacity_ = 0;
+	std::array<Shard, SHARDS_COUNT> shards_;
+	std::atomic<uint64_t> hits_{ 0 };
+	std::atomic<uint64_t> misses_{ 0 };
+	std::atomic<uint64_t> evictions_{ 0 };
+};
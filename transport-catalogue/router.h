@@ -1,11 +1,14 @@
 #pragma once
 
 #include "graph.h"
+#include "instrumentation.h"
+#include "query_workspace.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -20,7 +23,12 @@ namespace graph {
         using Graph = DirectedWeightedGraph<Weight>;
 
     public:
-        explicit Router(const Graph& graph);
+        // Для графов не больше max_precomputed_vertices вершин кратчайшие пути между всеми парами
+        // считаются заранее (V^2 памяти, V^3 времени). Для больших графов таблица не строится
+        // и каждый запрос выполняется поиском Дейкстры с остановкой в целевой вершине
+        explicit Router(const Graph& graph, size_t max_precomputed_vertices = MAX_PRECOMPUTED_VERTICES);
+
+        static constexpr size_t MAX_PRECOMPUTED_VERTICES = 1024;
 
         struct RouteInfo {
             Weight weight;
@@ -29,6 +37,38 @@ namespace graph {
 
         std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+        // То же, но рёбра пути записываются в буфер workspace.GetEdges() без выделения памяти
+        std::optional<Weight> BuildRoute(VertexId from, VertexId to, QueryWorkspace<Weight>& workspace) const;
+
+        // Поиск Дейкстры из from по всему графу: дерево кратчайших путей остаётся в workspace,
+        // и BuildRouteFromTree восстанавливает по нему пути до любых вершин без нового поиска.
+        // Дерево действительно до следующего поиска в том же workspace
+        void BuildShortestPathTree(VertexId from, QueryWorkspace<Weight>& workspace) const;
+
+        // То же от нескольких источников с начальными весами; поиск заканчивается, как только
+        // settle все вершины targets (без повторов). Недостижимые targets остаются не settled
+        void BuildShortestPathTree(const std::vector<std::pair<VertexId, Weight>>& sources, const std::vector<VertexId>& targets,
+            QueryWorkspace<Weight>& workspace) const;
+
+        // Путь до to в дереве BuildShortestPathTree, рёбра записываются в буфер workspace.GetEdges().
+        // Совпадает с BuildRoute(from, to): поиск с остановкой в to проходит те же вершины в том же порядке
+        std::optional<Weight> BuildRouteFromTree(VertexId to, QueryWorkspace<Weight>& workspace) const;
+
+        // Вес кратчайшего пути без восстановления списка рёбер
+        std::optional<Weight> GetRouteWeight(VertexId from, VertexId to) const;
+
+        // Построена ли таблица путей между всеми парами вершин
+        bool IsPrecomputed() const;
+
+        // Таблица путей между всеми парами вершин (V^2) и рабочее пространство текущего потока
+        instrumentation::MemoryBreakdown MemoryUsage() const;
+
+        // Поиск Дейкстры от нескольких источников с начальными весами, ограниченный весом max_weight.
+        // callback(vertex, weight) вызывается для каждой достижимой вершины в порядке возрастания веса.
+        template <typename Callback>
+        void ForEachReachable(const std::vector<std::pair<VertexId, Weight>>& sources, const Weight& max_weight, Callback callback,
+            QueryWorkspace<Weight>& workspace = QueryWorkspace<Weight>::ForCurrentThread()) const;
+
     private:
         struct RouteInternalData {
             Weight weight;
@@ -75,17 +115,43 @@ namespace graph {
             }
         }
 
-        static constexpr Weight ZERO_WEIGHT;
+        // Поиск Дейкстры от from до settle вершины to. Возвращает false, если to недостижима.
+        // С to == NO_VERTEX обходит всё достижимое из from
+        bool SearchRoute(VertexId from, VertexId to, QueryWorkspace<Weight>& workspace) const;
+
+        // Рёбра пути до to по предыдущим рёбрам поиска в workspace
+        void RestoreEdges(VertexId to, QueryWorkspace<Weight>& workspace) const;
+
+        static void PushVertex(QueryWorkspace<Weight>& workspace, VertexId vertex, const Weight& weight, EdgeId prev_edge) {
+            if (workspace.IsReached(vertex) && !(weight < workspace.GetWeight(vertex))) {
+                return;
+            }
+            workspace.SetWeight(vertex, weight, prev_edge);
+            std::vector<std::pair<Weight, VertexId>>& heap = workspace.GetHeap();
+            heap.emplace_back(weight, vertex);
+            std::push_heap(heap.begin(), heap.end(), HeapGreater);
+        }
+
+        static bool HeapGreater(const std::pair<Weight, VertexId>& lhs, const std::pair<Weight, VertexId>& rhs) {
+            return lhs.first > rhs.first;
+        }
+
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
         const Graph& graph_;
         RoutesInternalData routes_internal_data_;
     };
 
     template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
+    Router<Weight>::Router(const Graph& graph, size_t max_precomputed_vertices)
         : graph_(graph)
-        , routes_internal_data_(graph.GetVertexCount(),
-            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
     {
+        TC_SCOPED_TIMER("graph::Router::Router");
+        if (graph.GetVertexCount() > max_precomputed_vertices) {
+            return;
+        }
+        routes_internal_data_.assign(graph.GetVertexCount(),
+            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()));
         InitializeRoutesInternalData(graph);
 
         const size_t vertex_count = graph.GetVertexCount();
@@ -97,12 +163,31 @@ namespace graph {
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
         VertexId to) const {
+        QueryWorkspace<Weight>& workspace = QueryWorkspace<Weight>::ForCurrentThread();
+        const std::optional<Weight> weight = BuildRoute(from, to, workspace);
+        if (!weight) {
+            return std::nullopt;
+        }
+        return RouteInfo{ *weight, workspace.GetEdges() };
+    }
+
+    template <typename Weight>
+    std::optional<Weight> Router<Weight>::BuildRoute(VertexId from, VertexId to, QueryWorkspace<Weight>& workspace) const {
+        std::vector<EdgeId>& edges = workspace.GetEdges();
+        edges.clear();
+
+        if (!IsPrecomputed()) {
+            if (!SearchRoute(from, to, workspace)) {
+                return std::nullopt;
+            }
+            RestoreEdges(to, workspace);
+            return workspace.GetWeight(to);
+        }
+
         const auto& route_internal_data = routes_internal_data_.at(from).at(to);
         if (!route_internal_data) {
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
-        std::vector<EdgeId> edges;
         for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
             edge_id;
             edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
@@ -111,7 +196,165 @@ namespace graph {
         }
         std::reverse(edges.begin(), edges.end());
 
-        return RouteInfo{ weight, std::move(edges) };
+        return route_internal_data->weight;
+    }
+
+    template <typename Weight>
+    void Router<Weight>::BuildShortestPathTree(VertexId from, QueryWorkspace<Weight>& workspace) const {
+        SearchRoute(from, NO_VERTEX, workspace);
+    }
+
+    template <typename Weight>
+    void Router<Weight>::BuildShortestPathTree(const std::vector<std::pair<VertexId, Weight>>& sources, const std::vector<VertexId>& targets,
+        QueryWorkspace<Weight>& workspace) const {
+        workspace.Prepare(graph_.GetVertexCount());
+        std::vector<std::pair<Weight, VertexId>>& heap = workspace.GetHeap();
+        instrumentation::SearchWork& work = instrumentation::CurrentSearchWork();
+        ++work.searches;
+
+        for (const auto& [vertex, weight] : sources) {
+            PushVertex(workspace, vertex, weight, QueryWorkspace<Weight>::NO_EDGE);
+        }
+
+        size_t targets_left = targets.size();
+        while (!heap.empty() && targets_left > 0) {
+            std::pop_heap(heap.begin(), heap.end(), HeapGreater);
+            const auto [weight, vertex] = heap.back();
+            heap.pop_back();
+            if (workspace.IsSettled(vertex)) {
+                continue;
+            }
+            workspace.Settle(vertex);
+            ++work.vertices_settled;
+            if (std::find(targets.begin(), targets.end(), vertex) != targets.end()) {
+                --targets_left;
+            }
+
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                ++work.edges_relaxed;
+                PushVertex(workspace, edge.to, weight + edge.weight, edge_id);
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<Weight> Router<Weight>::BuildRouteFromTree(VertexId to, QueryWorkspace<Weight>& workspace) const {
+        std::vector<EdgeId>& edges = workspace.GetEdges();
+        edges.clear();
+        if (!workspace.IsSettled(to)) {
+            return std::nullopt;
+        }
+        RestoreEdges(to, workspace);
+        return workspace.GetWeight(to);
+    }
+
+    template <typename Weight>
+    std::optional<Weight> Router<Weight>::GetRouteWeight(VertexId from, VertexId to) const {
+        if (!IsPrecomputed()) {
+            QueryWorkspace<Weight>& workspace = QueryWorkspace<Weight>::ForCurrentThread();
+            if (!SearchRoute(from, to, workspace)) {
+                return std::nullopt;
+            }
+            return workspace.GetWeight(to);
+        }
+        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
+        if (!route_internal_data) {
+            return std::nullopt;
+        }
+        return route_internal_data->weight;
+    }
+
+    template <typename Weight>
+    bool Router<Weight>::IsPrecomputed() const {
+        return routes_internal_data_.size() == graph_.GetVertexCount();
+    }
+
+    template <typename Weight>
+    instrumentation::MemoryBreakdown Router<Weight>::MemoryUsage() const {
+        instrumentation::MemoryBreakdown usage;
+        usage.Add("routes_internal_data", instrumentation::GetHeapMemory(routes_internal_data_));
+        usage.Add("workspace", QueryWorkspace<Weight>::ForCurrentThread().MemoryUsage());
+        return usage;
+    }
+
+    template <typename Weight>
+    bool Router<Weight>::SearchRoute(VertexId from, VertexId to, QueryWorkspace<Weight>& workspace) const {
+        workspace.Prepare(graph_.GetVertexCount());
+        std::vector<std::pair<Weight, VertexId>>& heap = workspace.GetHeap();
+        instrumentation::SearchWork& work = instrumentation::CurrentSearchWork();
+        ++work.searches;
+        PushVertex(workspace, from, ZERO_WEIGHT, QueryWorkspace<Weight>::NO_EDGE);
+
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), HeapGreater);
+            const auto [weight, vertex] = heap.back();
+            heap.pop_back();
+            if (workspace.IsSettled(vertex)) {
+                continue;
+            }
+            workspace.Settle(vertex);
+            ++work.vertices_settled;
+            if (vertex == to) {
+                return true;
+            }
+
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                ++work.edges_relaxed;
+                PushVertex(workspace, edge.to, weight + edge.weight, edge_id);
+            }
+        }
+        return false;
+    }
+
+    template <typename Weight>
+    void Router<Weight>::RestoreEdges(VertexId to, QueryWorkspace<Weight>& workspace) const {
+        std::vector<EdgeId>& edges = workspace.GetEdges();
+        for (EdgeId edge_id = workspace.GetPrevEdge(to);
+            edge_id != QueryWorkspace<Weight>::NO_EDGE;
+            edge_id = workspace.GetPrevEdge(graph_.GetEdge(edge_id).from))
+        {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+    }
+
+    template <typename Weight>
+    template <typename Callback>
+    void Router<Weight>::ForEachReachable(const std::vector<std::pair<VertexId, Weight>>& sources, const Weight& max_weight, Callback callback,
+        QueryWorkspace<Weight>& workspace) const {
+        workspace.Prepare(graph_.GetVertexCount());
+        std::vector<std::pair<Weight, VertexId>>& heap = workspace.GetHeap();
+        instrumentation::SearchWork& work = instrumentation::CurrentSearchWork();
+        ++work.searches;
+
+        for (const auto& [vertex, weight] : sources) {
+            if (!(weight > max_weight)) {
+                PushVertex(workspace, vertex, weight, QueryWorkspace<Weight>::NO_EDGE);
+            }
+        }
+
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), HeapGreater);
+            const auto [weight, vertex] = heap.back();
+            heap.pop_back();
+            if (workspace.IsSettled(vertex)) {
+                continue;
+            }
+            workspace.Settle(vertex);
+            ++work.vertices_settled;
+            callback(vertex, weight);
+
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+                const auto& edge = graph_.GetEdge(edge_id);
+                const Weight candidate_weight = weight + edge.weight;
+                ++work.edges_relaxed;
+                if (!(candidate_weight > max_weight)) {
+                    PushVertex(workspace, edge.to, candidate_weight, edge_id);
+                }
+            }
+        }
     }
 
 }  // namespace graph
\ No newline at end of file
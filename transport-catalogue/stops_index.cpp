@@ -0,0 +1,118 @@
+#include "stops_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace catalogue;
+
+namespace {
+	const double EARTH_RADIUS = 6371000.;
+	const double DEGREE_TO_METERS = 3.1415926535 / 180. * EARTH_RADIUS;
+}
+
+StopsIndex::StopsIndex(const std::deque<Stop>& stops) {
+	if (stops.empty()) {
+		return;
+	}
+
+	double max_lat = stops.front().coordinates.lat;
+	double max_lng = stops.front().coordinates.lng;
+	min_lat_ = max_lat;
+	min_lng_ = max_lng;
+	for (const Stop& stop : stops) {
+		min_lat_ = std::min(min_lat_, stop.coordinates.lat);
+		min_lng_ = std::min(min_lng_, stop.coordinates.lng);
+		max_lat = std::max(max_lat, stop.coordinates.lat);
+		max_lng = std::max(max_lng, stop.coordinates.lng);
+	}
+
+	// долгота "сжимается" к полюсам, для оценки берём самую высокую широту области
+	const double lng_scale = std::max(std::cos(std::max(std::abs(min_lat_), std::abs(max_lat)) * 3.1415926535 / 180.), 1e-6);
+	const double height = (max_lat - min_lat_) * DEGREE_TO_METERS;
+	const double width = (max_lng - min_lng_) * DEGREE_TO_METERS * lng_scale;
+
+	// в среднем одна остановка на ячейку
+	double cell_meters = std::sqrt(std::max(height, 1.) * std::max(width, 1.) / static_cast<double>(stops.size()));
+	cell_meters = std::max(cell_meters, 1.);
+
+	cell_lat_ = cell_meters / DEGREE_TO_METERS;
+	cell_lng_ = cell_meters / (DEGREE_TO_METERS * lng_scale);
+	cell_min_meters_ = cell_meters;
+	rows_ = static_cast<size_t>((max_lat - min_lat_) / cell_lat_) + 1;
+	cols_ = static_cast<size_t>((max_lng - min_lng_) / cell_lng_) + 1;
+
+	cell_offsets_.assign(rows_ * cols_ + 1, 0);
+	for (const Stop& stop : stops) {
+		++cell_offsets_[GetRow(stop.coordinates.lat) * cols_ + GetCol(stop.coordinates.lng) + 1];
+	}
+	for (size_t i = 1; i < cell_offsets_.size(); ++i) {
+		cell_offsets_[i] += cell_offsets_[i - 1];
+	}
+
+	cell_stops_.resize(stops.size());
+	std::vector<size_t> fill(cell_offsets_.begin(), cell_offsets_.end() - 1);
+	for (const Stop& stop : stops) {
+		cell_stops_[fill[GetRow(stop.coordinates.lat) * cols_ + GetCol(stop.coordinates.lng)]++] = &stop;
+	}
+}
+
+size_t StopsIndex::GetRow(double lat) const {
+	const double row = std::floor((lat - min_lat_) / cell_lat_);
+	return static_cast<size_t>(std::clamp(row, 0., static_cast<double>(rows_ - 1)));
+}
+
+size_t StopsIndex::GetCol(double lng) const {
+	const double col = std::floor((lng - min_lng_) / cell_lng_);
+	return static_cast<size_t>(std::clamp(col, 0., static_cast<double>(cols_ - 1)));
+}
+
+std::vector<std::pair<StopPtr, double>> StopsIndex::FindNearest(detail::Coordinates point, size_t count) const {
+	std::vector<std::pair<StopPtr, double>> result;
+	if (count == 0 || cell_stops_.empty()) {
+		return result;
+	}
+
+	const auto by_distance = [](const std::pair<StopPtr, double>& lhs, const std::pair<StopPtr, double>& rhs) {
+		return lhs.second < rhs.second;
+	};
+
+	const long long center_row = static_cast<long long>(GetRow(point.lat));
+	const long long center_col = static_cast<long long>(GetCol(point.lng));
+	const long long max_ring = static_cast<long long>(std::max(rows_, cols_));
+
+	// обходим кольца ячеек вокруг точки, пока следующее кольцо может дать кого-то ближе найденных
+	for (long long ring = 0; ring <= max_ring; ++ring) {
+		if (result.size() >= count && (ring - 1) * cell_min_meters_ > result.back().second) {
+			break;
+		}
+		for (long long row = center_row - ring; row <= center_row + ring; ++row) {
+			if (row < 0 || row >= static_cast<long long>(rows_)) {
+				continue;
+			}
+			const bool edge_row = row == center_row - ring || row == center_row + ring;
+			const long long step = edge_row ? 1 : 2 * ring;
+			for (long long col = center_col - ring; col <= center_col + ring; col += std::max(step, 1LL)) {
+				if (col < 0 || col >= static_cast<long long>(cols_)) {
+					continue;
+				}
+				const size_t cell = static_cast<size_t>(row) * cols_ + static_cast<size_t>(col);
+				for (size_t i = cell_offsets_[cell]; i < cell_offsets_[cell + 1]; ++i) {
+					const double distance = detail::ComputeDistance(point, cell_stops_[i]->coordinates);
+					if (result.size() < count) {
+						result.emplace_back(cell_stops_[i], distance);
+						std::sort(result.begin(), result.end(), by_distance);
+					}
+					else if (distance < result.back().second) {
+						result.back() = { cell_stops_[i], distance };
+						std::sort(result.begin(), result.end(), by_distance);
+					}
+				}
+			}
+		}
+	}
+	return result;
+}
+
+size_t StopsIndex::MemoryUsage() const {
+	return instrumentation::GetHeapMemory(cell_offsets_) + instrumentation::GetHeapMemory(cell_stops_);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "domain.h"
+#include "geo.h"
+#include "memory_usage.h"
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace catalogue {
+
+	// Равномерная сетка по координатам остановок для поиска ближайших к точке
+	class StopsIndex {
+	public:
+		StopsIndex() = default;
+		explicit StopsIndex(const std::deque<Stop>& stops);
+
+		// Возвращает до count ближайших остановок вместе с расстоянием до них в метрах,
+		// отсортированных по возрастанию расстояния
+		std::vector<std::pair<StopPtr, double>> FindNearest(detail::Coordinates point, size_t count) const;
+
+		size_t MemoryUsage() const;
+
+	private:
+		size_t GetRow(double lat) const;
+		size_t GetCol(double lng) const;
+
+		double min_lat_ = 0.;
+		double min_lng_ = 0.;
+		double cell_lat_ = 1.;
+		double cell_lng_ = 1.;
+		// нижняя оценка размера ячейки в метрах, нужна для остановки поиска по кольцам
+		double cell_min_meters_ = 0.;
+		size_t rows_ = 0;
+		size_t cols_ = 0;
+
+		// ячейки хранятся подряд: остановки ячейки i лежат в [cell_offsets_[i], cell_offsets_[i + 1])
+		std::vector<size_t> cell_offsets_;
+		std::vector<StopPtr> cell_stops_;
+	};
+}
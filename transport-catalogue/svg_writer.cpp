@@ -0,0 +1,143 @@
+#include "svg_writer.h"
+
+#include <charconv>
+#include <cstdio>
+#include <sstream>
+
+namespace svg {
+
+    using namespace std::literals;
+
+    namespace {
+        const std::string_view INDENT = "  "sv;
+    }
+
+    std::string Style::Build() const {
+        std::ostringstream out;
+        RenderAttrs(out);
+        return out.str();
+    }
+
+    StreamWriter::StreamWriter(std::string& buffer)
+        : out_(buffer) {
+    }
+
+    void StreamWriter::StartDocument() {
+        out_ += R"(<?xml version="1.0" encoding="UTF-8" ?>)"sv;
+        out_ += '\n';
+        out_ += R"(<svg xmlns="http://www.w3.org/2000/svg" version="1.1">)"sv;
+        out_ += '\n';
+    }
+
+    void StreamWriter::EndDocument() {
+        out_ += "</svg>"sv;
+    }
+
+    void StreamWriter::AddCircle(Point center, double radius, std::string_view style) {
+        out_ += INDENT;
+        out_ += "<circle cx=\""sv;
+        AppendNumber(out_, center.x);
+        out_ += "\" cy=\""sv;
+        AppendNumber(out_, center.y);
+        out_ += "\" r=\""sv;
+        AppendNumber(out_, radius);
+        out_ += '"';
+        out_ += style;
+        out_ += "/>\n"sv;
+    }
+
+    void StreamWriter::StartPolyline() {
+        out_ += INDENT;
+        out_ += "<polyline points=\""sv;
+        first_point_ = true;
+    }
+
+    void StreamWriter::AddPolylinePoint(Point point) {
+        if (!first_point_) {
+            out_ += ' ';
+        }
+        first_point_ = false;
+        AppendNumber(out_, point.x);
+        out_ += ',';
+        AppendNumber(out_, point.y);
+    }
+
+    void StreamWriter::EndPolyline(std::string_view style) {
+        out_ += '"';
+        out_ += style;
+        out_ += "/>\n"sv;
+    }
+
+    void StreamWriter::AddText(Point position, Point offset, uint32_t font_size, std::string_view font_family,
+        std::string_view font_weight, std::string_view style, std::string_view data) {
+        out_ += INDENT;
+        out_ += "<text x=\""sv;
+        AppendNumber(out_, position.x);
+        out_ += "\" y=\""sv;
+        AppendNumber(out_, position.y);
+        out_ += "\" dx=\""sv;
+        AppendNumber(out_, offset.x);
+        out_ += "\" dy=\""sv;
+        AppendNumber(out_, offset.y);
+        out_ += "\" font-size=\""sv;
+        out_ += std::to_string(font_size);
+        out_ += '"';
+        if (!font_family.empty()) {
+            out_ += " font-family=\""sv;
+            out_ += font_family;
+            out_ += '"';
+        }
+        if (!font_weight.empty()) {
+            out_ += " font-weight=\""sv;
+            out_ += font_weight;
+            out_ += '"';
+        }
+        out_ += style;
+        out_ += '>';
+        AppendEscaped(data);
+        out_ += "</text>\n"sv;
+    }
+
+    void StreamWriter::AddRaw(std::string_view fragment) {
+        out_ += fragment;
+    }
+
+    void StreamWriter::AppendNumber(std::string& out, double value) {
+        // тот же вид, что у ostream по умолчанию (%g, 6 значащих цифр). std::to_chars для double есть
+        // только с libstdc++ 11 и MSVC 2019 16.4, на остальных поддерживаемых компиляторах - snprintf
+        char buffer[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 6);
+        out.append(buffer, result.ptr);
+#else
+        const int length = std::snprintf(buffer, sizeof(buffer), "%g", value);
+        out.append(buffer, static_cast<size_t>(length));
+#endif
+    }
+
+    void StreamWriter::AppendEscaped(std::string_view text) {
+        for (const char ch : text) {
+            switch (ch) {
+            case '"':
+                out_ += "&quot;"sv;
+                break;
+            case '\'':
+                out_ += "&apos;"sv;
+                break;
+            case '<':
+                out_ += "&lt;"sv;
+                break;
+            case '>':
+                out_ += "&gt;"sv;
+                break;
+            case '&':
+                out_ += "&amp;"sv;
+                break;
+            default:
+                out_ += ch;
+                break;
+            }
+        }
+    }
+
+}  // namespace svg
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "svg.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace svg {
+
+    // Строка атрибутов оформления (fill, stroke, ...) в том же виде, в каком их выводит PathProps.
+    // Строится один раз, например для каждого цвета палитры, и затем вставляется как есть
+    class Style final : public PathProps<Style> {
+    public:
+        std::string Build() const;
+    };
+
+    // Записывает SVG-примитивы сразу в непрерывный буфер, без создания объектов svg::Object.
+    // Для тех же примитивов и атрибутов вывод побайтно совпадает с svg::Document::Render
+    class StreamWriter {
+    public:
+        explicit StreamWriter(std::string& buffer);
+
+        void StartDocument();
+        void EndDocument();
+
+        void AddCircle(Point center, double radius, std::string_view style);
+
+        void StartPolyline();
+        void AddPolylinePoint(Point point);
+        void EndPolyline(std::string_view style);
+
+        void AddText(Point position, Point offset, uint32_t font_size, std::string_view font_family,
+            std::string_view font_weight, std::string_view style, std::string_view data);
+
+        // Дописывает уже готовый фрагмент документа, например отрисованный в другом потоке
+        void AddRaw(std::string_view fragment);
+
+        // Число в том же формате, что выводит std::ostream по умолчанию (%g, 6 значащих цифр)
+        static void AppendNumber(std::string& out, double value);
+
+    private:
+        void AppendEscaped(std::string_view text);
+
+        std::string& out_;
+        bool first_point_ = true;
+    };
+
+}  // namespace svg
@@ -0,0 +1,218 @@
+#include "timetable_router.h"
+
+#include <algorithm>
+
+TimetableRouter::TimetableRouter(const catalogue::TransportCatalogue& catalogue, const RouteSettings& settings) {
+	for (const Stop& stop : *catalogue.GetStops()) {
+		stop_ids_.insert({ stop.stop_name, static_cast<uint32_t>(stops_.size()) });
+		stops_.push_back(&stop);
+	}
+
+	route_stop_offsets_.push_back(0);
+	trip_offsets_.push_back(0);
+	for (const Bus& bus : *catalogue.GetBuses()) {
+		const RouteStops route_stops = bus.GetRouteStops();
+		if (bus.departures.empty() || route_stops.size() < 2) {
+			continue;
+		}
+		const double velocity = (bus.velocity > 0 ? bus.velocity : settings.bus_velocity) * TRANSLATE_TO_M_MIN;
+
+		double time = 0.;
+		for (size_t i = 0; i < route_stops.size(); ++i) {
+			if (i > 0) {
+				time += catalogue.GetDistance(route_stops[i - 1], route_stops[i]) / velocity;
+			}
+			route_stops_.push_back(stop_ids_.at(route_stops[i]->stop_name));
+			route_times_.push_back(time);
+		}
+		departures_.insert(departures_.end(), bus.departures.begin(), bus.departures.end());
+
+		route_buses_.push_back(&bus);
+		route_stop_offsets_.push_back(static_cast<uint32_t>(route_stops_.size()));
+		trip_offsets_.push_back(static_cast<uint32_t>(departures_.size()));
+	}
+
+	stop_route_offsets_.assign(stops_.size() + 1, 0);
+	for (uint32_t stop : route_stops_) {
+		++stop_route_offsets_[stop + 1];
+	}
+	for (size_t i = 1; i < stop_route_offsets_.size(); ++i) {
+		stop_route_offsets_[i] += stop_route_offsets_[i - 1];
+	}
+	stop_routes_.resize(route_stops_.size());
+	std::vector<uint32_t> fill(stop_route_offsets_.begin(), stop_route_offsets_.end() - 1);
+	for (uint32_t route = 0; route + 1 < route_stop_offsets_.size(); ++route) {
+		for (uint32_t i = route_stop_offsets_[route]; i < route_stop_offsets_[route + 1]; ++i) {
+			stop_routes_[fill[route_stops_[i]]++] = { route, i - route_stop_offsets_[route] };
+		}
+	}
+}
+
+size_t TimetableRouter::GetConnectionCount() const {
+	size_t result = 0;
+	for (size_t route = 0; route + 1 < route_stop_offsets_.size(); ++route) {
+		result += (route_stop_offsets_[route + 1] - route_stop_offsets_[route] - 1) * (trip_offsets_[route + 1] - trip_offsets_[route]);
+	}
+	return result;
+}
+
+double TimetableRouter::GetTripTime(uint32_t route, uint32_t trip, uint32_t index) const {
+	return departures_[trip_offsets_[route] + trip] + route_times_[route_stop_offsets_[route] + index];
+}
+
+uint32_t TimetableRouter::FindTrip(uint32_t route, uint32_t index, double time) const {
+	const auto begin = departures_.begin() + trip_offsets_[route];
+	const auto end = departures_.begin() + trip_offsets_[route + 1];
+	const auto it = std::lower_bound(begin, end, time - route_times_[route_stop_offsets_[route] + index]);
+	return it == end ? NONE : static_cast<uint32_t>(it - begin);
+}
+
+std::vector<Journey> TimetableRouter::BuildJourneys(std::string_view from, std::string_view to, double departure_time, size_t max_transfers) const {
+	std::vector<Journey> result;
+	const auto from_it = stop_ids_.find(from);
+	const auto to_it = stop_ids_.find(to);
+	if (from_it == stop_ids_.end() || to_it == stop_ids_.end()) {
+		return result;
+	}
+	const uint32_t source = from_it->second;
+	const uint32_t target = to_it->second;
+	if (source == target) {
+		result.push_back({ departure_time, 0, {} });
+		return result;
+	}
+
+	const size_t stop_count = stops_.size();
+	const size_t route_count = route_buses_.size();
+	// в поездке без повторных посадок пересадок меньше, чем остановок
+	const size_t rounds = std::min({ max_transfers, stop_count, MAX_TRANSFERS_LIMIT }) + 1;
+
+	static thread_local Workspace workspace;
+	workspace.Prepare(stop_count, (rounds + 1) * stop_count, route_count);
+
+	workspace.SetArrival(source, 0, departure_time);
+	workspace.marked_stops.push_back(source);
+
+	for (uint32_t round = 1; round <= rounds && !workspace.marked_stops.empty(); ++round) {
+		const size_t labels_begin = round * stop_count;
+
+		// для каждого маршрута запоминаем самую раннюю отмеченную остановку
+		for (uint32_t stop : workspace.marked_stops) {
+			workspace.is_marked[stop] = 0;
+			for (uint32_t i = stop_route_offsets_[stop]; i < stop_route_offsets_[stop + 1]; ++i) {
+				const auto [route, index] = stop_routes_[i];
+				uint32_t& queue_index = workspace.route_queue_index[route];
+				if (queue_index == NONE) {
+					workspace.queued_routes.push_back(route);
+					queue_index = index;
+				}
+				else {
+					queue_index = std::min(queue_index, index);
+				}
+			}
+		}
+		workspace.marked_stops.clear();
+
+		for (uint32_t route : workspace.queued_routes) {
+			const uint32_t first_index = workspace.route_queue_index[route];
+			workspace.route_queue_index[route] = NONE;
+			const uint32_t route_begin = route_stop_offsets_[route];
+			const uint32_t route_size = route_stop_offsets_[route + 1] - route_begin;
+
+			uint32_t trip = NONE;
+			uint32_t board_index = 0;
+			for (uint32_t index = first_index; index < route_size; ++index) {
+				const uint32_t stop = route_stops_[route_begin + index];
+
+				if (trip != NONE) {
+					const double arrival = GetTripTime(route, trip, index);
+					if (arrival < std::min(workspace.GetArrival(stop), workspace.GetArrival(target))) {
+						workspace.SetArrival(stop, round, arrival);
+						workspace.SetLabel(labels_begin + stop, { route, trip, board_index, index });
+						if (!workspace.is_marked[stop]) {
+							workspace.is_marked[stop] = 1;
+							workspace.marked_stops.push_back(stop);
+						}
+					}
+				}
+
+				// успеваем ли на остановке на более ранний рейс
+				const double ready_time = workspace.GetPreviousArrival(stop, round);
+				if (ready_time < INF && (trip == NONE || ready_time <= GetTripTime(route, trip, index))) {
+					const uint32_t earlier_trip = FindTrip(route, index, ready_time);
+					if (earlier_trip != NONE && (trip == NONE || earlier_trip < trip)) {
+						trip = earlier_trip;
+						board_index = index;
+					}
+				}
+			}
+		}
+		workspace.queued_routes.clear();
+
+		if (workspace.IsImproved(target, round)) {
+			result.push_back(MakeJourney(workspace, round, target, departure_time));
+		}
+	}
+	// отметки, оставшиеся после последнего раунда, снимаются для следующего запроса
+	for (uint32_t stop : workspace.marked_stops) {
+		workspace.is_marked[stop] = 0;
+	}
+	return result;
+}
+
+void TimetableRouter::Workspace::Prepare(size_t stop_count, size_t label_count, size_t route_count) {
+	if (arrivals.size() < stop_count) {
+		arrivals.resize(stop_count);
+		is_marked.resize(stop_count, 0);
+	}
+	if (labels.size() < label_count) {
+		labels.resize(label_count);
+		label_stamps.resize(label_count, 0);
+	}
+	if (route_queue_index.size() < route_count) {
+		route_queue_index.resize(route_count, NONE);
+	}
+	if (stamp == std::numeric_limits<uint32_t>::max()) {
+		for (StopArrival& arrival : arrivals) {
+			arrival.stamp = 0;
+		}
+		std::fill(label_stamps.begin(), label_stamps.end(), 0);
+		stamp = 0;
+	}
+	++stamp;
+	marked_stops.clear();
+	queued_routes.clear();
+}
+
+Journey TimetableRouter::MakeJourney(const Workspace& workspace, size_t round, uint32_t target, double departure_time) const {
+	const size_t stop_count = stops_.size();
+
+	// восстанавливаем поездки с конца: если метка перенесена из прошлого раунда, спускаемся к нему
+	std::vector<Label> legs;
+	uint32_t stop = target;
+	while (round > 0) {
+		const Label* label = workspace.GetLabel(round * stop_count + stop);
+		if (label == nullptr) {
+			--round;
+			continue;
+		}
+		legs.push_back(*label);
+		stop = route_stops_[route_stop_offsets_[label->route] + label->board_index];
+		--round;
+	}
+	std::reverse(legs.begin(), legs.end());
+
+	Journey journey;
+	journey.transfers = static_cast<int>(legs.size()) - 1;
+	double ready_time = departure_time;
+	for (const Label& leg : legs) {
+		const double board_time = GetTripTime(leg.route, leg.trip, leg.board_index);
+		const double alight_time = GetTripTime(leg.route, leg.trip, leg.alight_index);
+		const StopPtr board_stop = stops_[route_stops_[route_stop_offsets_[leg.route] + leg.board_index]];
+
+		journey.items.push_back({ true, board_stop->stop_name, board_time - ready_time, 0 });
+		journey.items.push_back({ false, route_buses_[leg.route]->bus_name, alight_time - board_time, static_cast<int>(leg.alight_index - leg.board_index) });
+		ready_time = alight_time;
+	}
+	journey.arrival_time = ready_time;
+	return journey;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "domain.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+// Поездка по расписанию: время прибытия, число пересадок и элементы маршрута в формате запроса Route
+struct Journey {
+	double arrival_time = 0.;
+	int transfers = 0;
+	std::vector<RouteWeight> items;
+};
+
+// Маршрутизация по расписанию рейсов (алгоритм RAPTOR).
+// Каждый маршрут с расписанием превращается в шаблон: список остановок и время движения от начальной
+// остановки до каждой из них. Все рейсы маршрута едут по одному шаблону, поэтому время рейса на
+// остановке - это время отправления плюс смещение, и ближайший рейс ищется бинпоиском по отправлениям.
+// Все данные лежат в плоских массивах, остановки и маршруты пронумерованы подряд
+class TimetableRouter {
+public:
+	TimetableRouter(const catalogue::TransportCatalogue& catalogue, const RouteSettings& settings);
+
+	// Парето-оптимальные по времени прибытия и числу пересадок поездки с отправлением не раньше departure_time,
+	// по возрастанию числа пересадок. Пустой результат - добраться нельзя.
+	// max_transfers ограничивается числом остановок и MAX_TRANSFERS_LIMIT: память поиска растёт с числом раундов
+	std::vector<Journey> BuildJourneys(std::string_view from, std::string_view to, double departure_time,
+		size_t max_transfers = MAX_TRANSFERS) const;
+
+	size_t GetConnectionCount() const;
+
+	static constexpr size_t MAX_TRANSFERS = 7;
+	static constexpr size_t MAX_TRANSFERS_LIMIT = 64;
+
+private:
+	constexpr static double TRANSLATE_TO_M_MIN = 1000.0 / 60.0;
+	constexpr static uint32_t NONE = std::numeric_limits<uint32_t>::max();
+	constexpr static double INF = std::numeric_limits<double>::infinity();
+
+	// Откуда взялась метка остановки в раунде: маршрут, рейс и индексы посадки и высадки в шаблоне
+	struct Label {
+		uint32_t route = NONE;
+		uint32_t trip = NONE;
+		uint32_t board_index = 0;
+		uint32_t alight_index = 0;
+	};
+
+	// Рабочее пространство поиска. Как в graph::QueryWorkspace, массивы не очищаются между запросами:
+	// прибытие на остановку и метка действительны, только если их номер запроса совпадает с текущим,
+	// поэтому запрос не тратит O(раунды * остановки) на сброс
+	struct Workspace {
+		// лучшее прибытие на остановку, раунд, в котором оно найдено, и лучшее прибытие до этого раунда
+		struct StopArrival {
+			double best = INF;
+			double previous = INF;
+			uint32_t round = 0;
+			uint32_t stamp = 0;
+		};
+
+		std::vector<StopArrival> arrivals;
+		// метка остановки s в раунде k - labels[k * stop_count + s]
+		std::vector<Label> labels;
+		std::vector<uint32_t> label_stamps;
+		uint32_t stamp = 0;
+
+		std::vector<uint32_t> marked_stops;
+		// между запросами все 0
+		std::vector<char> is_marked;
+		std::vector<uint32_t> queued_routes;
+		// между запросами все NONE
+		std::vector<uint32_t> route_queue_index;
+
+		void Prepare(size_t stop_count, size_t label_count, size_t route_count);
+
+		double GetArrival(uint32_t stop) const {
+			const StopArrival& arrival = arrivals[stop];
+			return arrival.stamp == stamp ? arrival.best : INF;
+		}
+
+		// Лучшее прибытие за раунды до round
+		double GetPreviousArrival(uint32_t stop, uint32_t round) const {
+			const StopArrival& arrival = arrivals[stop];
+			if (arrival.stamp != stamp) {
+				return INF;
+			}
+			return arrival.round == round ? arrival.previous : arrival.best;
+		}
+
+		bool IsImproved(uint32_t stop, uint32_t round) const {
+			return arrivals[stop].stamp == stamp && arrivals[stop].round == round;
+		}
+
+		void SetArrival(uint32_t stop, uint32_t round, double time) {
+			StopArrival& arrival = arrivals[stop];
+			if (arrival.stamp != stamp) {
+				arrival = { time, INF, round, stamp };
+				return;
+			}
+			if (arrival.round != round) {
+				arrival.previous = arrival.best;
+				arrival.round = round;
+			}
+			arrival.best = time;
+		}
+
+		const Label* GetLabel(size_t index) const {
+			return label_stamps[index] == stamp ? &labels[index] : nullptr;
+		}
+
+		void SetLabel(size_t index, const Label& label) {
+			labels[index] = label;
+			label_stamps[index] = stamp;
+		}
+	};
+
+	// Первый рейс маршрута route, уходящий с остановки с индексом index не раньше time
+	uint32_t FindTrip(uint32_t route, uint32_t index, double time) const;
+
+	double GetTripTime(uint32_t route, uint32_t trip, uint32_t index) const;
+
+	Journey MakeJourney(const Workspace& workspace, size_t round, uint32_t target, double departure_time) const;
+
+	std::vector<StopPtr> stops_;
+	std::unordered_map<std::string_view, uint32_t> stop_ids_;
+	std::vector<BusPtr> route_buses_;
+
+	// остановки шаблона r - route_stops_[route_stop_offsets_[r] .. route_stop_offsets_[r + 1]),
+	// смещения времени от начала рейса лежат в route_times_ по тем же индексам
+	std::vector<uint32_t> route_stop_offsets_;
+	std::vector<uint32_t> route_stops_;
+	std::vector<double> route_times_;
+
+	// отправления рейсов шаблона r - departures_[trip_offsets_[r] .. trip_offsets_[r + 1]), по возрастанию
+	std::vector<uint32_t> trip_offsets_;
+	std::vector<double> departures_;
+
+	// маршруты через остановку s с индексом остановки в шаблоне - stop_routes_[stop_route_offsets_[s] .. stop_route_offsets_[s + 1])
+	std::vector<uint32_t> stop_route_offsets_;
+	std::vector<std::pair<uint32_t, uint32_t>> stop_routes_;
+};
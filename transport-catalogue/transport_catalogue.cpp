@@ -3,23 +3,41 @@
 using namespace catalogue;
 
 void TransportCatalogue::AddStop(const std::string& stop_name, const detail::Coordinates& coordinates) {
-	Stop stop{ stop_name, coordinates.lat, coordinates.lng };
+	Stop stop{ names_.CopyString(stop_name), coordinates, stops_.size() };
 	stops_.emplace_back(std::move(stop));
 	stopname_to_stop_[stops_.back().stop_name] = &stops_.back();
+	++version_;
 }
 
 void TransportCatalogue::AddDistance(StopPtr stop_from, StopPtr stop_to, int distance) {
 	pair_stop_to_distance_[{stop_from, stop_to}] = distance;
+	++version_;
 }
 
-void TransportCatalogue::AddBus(const std::string& bus_name, const std::vector<StopPtr> stops, bool is_roundtrip) {
-	const Bus bus{ bus_name, std::move(stops), is_roundtrip };
+void TransportCatalogue::AddBus(const std::string& bus_name, const std::vector<StopPtr> stops, bool is_roundtrip, double headway, double velocity,
+	std::vector<double> departures) {
+	std::sort(departures.begin(), departures.end());
+	Bus bus{ names_.CopyString(bus_name), stop_sequences_.CopyArray(stops.data(), stops.size()), is_roundtrip, headway, velocity,
+		std::move(departures) };
 	buses_.emplace_back(std::move(bus));
 	busname_to_bus_[buses_.back().bus_name] = &buses_.back();
 
-	for (StopPtr stop : buses_.back().stops) {
-		bus_by_stop_[stop].insert(&buses_.back());
+	BusPtr added_bus = &buses_.back();
+	// маршрут с тем же названием заменяет прежний, как и в busname_to_bus_
+	const bool replaced = sorted_buses_.erase(added_bus) > 0;
+	sorted_buses_.insert(added_bus);
+
+	if (replaced) {
+		// остановки прежнего маршрута могли остаться без маршрутов, набор собирается заново
+		sorted_served_stops_.clear();
+		for (BusPtr bus : sorted_buses_) {
+			sorted_served_stops_.insert(bus->stops.begin(), bus->stops.end());
+		}
 	}
+	else {
+		sorted_served_stops_.insert(added_bus->stops.begin(), added_bus->stops.end());
+	}
+	++version_;
 }
 
 BusStat TransportCatalogue::RequestBus(std::string_view bus_name) const {
@@ -31,10 +49,11 @@ BusStat TransportCatalogue::RequestBus(std::string_view bus_name) const {
 
 		double geo_distance = 0;
 		// Compute distance
-		detail::Coordinates previous_coord{ bus->stops[0]->coordinates };
-		StopPtr previous_stop = bus->stops[0];
+		const RouteStops route_stops = bus->GetRouteStops();
+		detail::Coordinates previous_coord{ route_stops[0]->coordinates };
+		StopPtr previous_stop = route_stops[0];
 		bool first_iter = true;
-		for (StopPtr stop : bus->stops) {
+		for (StopPtr stop : route_stops) {
 			if (first_iter) {
 				first_iter = false;
 				unique_stops_names.insert(stop->stop_name);
@@ -47,19 +66,62 @@ BusStat TransportCatalogue::RequestBus(std::string_view bus_name) const {
 			unique_stops_names.insert(stop->stop_name);
 		}
 		stats.unique_stops = unique_stops_names.size();
-		stats.total_stops = bus->stops.size();
+		stats.total_stops = route_stops.size();
 		stats.curvature = stats.route_length / geo_distance;
 		return stats;
 	}
 	return {};
 }
 
-const std::unordered_set<BusPtr>* TransportCatalogue::RequestStop(StopPtr stop) const {
-	if (bus_by_stop_.count(stop)) {
-		const std::unordered_set<BusPtr>* buses_by_stop = &bus_by_stop_.at(stop);
-		return buses_by_stop;
+BusesRange TransportCatalogue::RequestStop(StopPtr stop) const {
+	UpdateStopBuses();
+	if (stop == nullptr) {
+		return { stop_buses_.end(), stop_buses_.end() };
 	}
-	return nullptr;
+	return { stop_buses_.begin() + stop_bus_offsets_[stop->id], stop_buses_.begin() + stop_bus_offsets_[stop->id + 1] };
+}
+
+void TransportCatalogue::UpdateStopBuses() const {
+	if (stop_buses_version_.load(std::memory_order_acquire) != version_) {
+		std::lock_guard guard(stop_buses_mutex_);
+		if (stop_buses_version_.load(std::memory_order_relaxed) != version_) {
+			BuildStopBuses();
+			stop_buses_version_.store(version_, std::memory_order_release);
+		}
+	}
+}
+
+void TransportCatalogue::BuildStopBuses() const {
+	// маршруты перебираются в порядке названий, поэтому списки остановок сразу упорядочены.
+	// last_bus отсекает повторные заезды маршрута на ту же остановку
+	std::vector<BusPtr> last_bus(stops_.size(), nullptr);
+	std::vector<uint32_t> offsets(stops_.size() + 1, 0);
+	for (BusPtr bus : sorted_buses_) {
+		for (StopPtr stop : bus->stops) {
+			if (last_bus[stop->id] != bus) {
+				last_bus[stop->id] = bus;
+				++offsets[stop->id + 1];
+			}
+		}
+	}
+	for (size_t i = 1; i < offsets.size(); ++i) {
+		offsets[i] += offsets[i - 1];
+	}
+
+	std::vector<BusPtr> buses(offsets.back());
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	std::fill(last_bus.begin(), last_bus.end(), nullptr);
+	for (BusPtr bus : sorted_buses_) {
+		for (StopPtr stop : bus->stops) {
+			if (last_bus[stop->id] != bus) {
+				last_bus[stop->id] = bus;
+				buses[fill[stop->id]++] = bus;
+			}
+		}
+	}
+
+	stop_bus_offsets_ = std::move(offsets);
+	stop_buses_ = std::move(buses);
 }
 
 StopPtr TransportCatalogue::GetStop(std::string_view stop_name) const {
@@ -76,8 +138,12 @@ BusPtr TransportCatalogue::GetBus(std::string_view bus_name) const {
 	return nullptr;
 }
 
-const std::unordered_map<StopPtr, std::unordered_set<BusPtr>>* catalogue::TransportCatalogue::GetBusesByStop() const {
-	return &bus_by_stop_;
+const SortedBuses* catalogue::TransportCatalogue::GetSortedBuses() const {
+	return &sorted_buses_;
+}
+
+const SortedStops* catalogue::TransportCatalogue::GetSortedServedStops() const {
+	return &sorted_served_stops_;
 }
 
 const BusMap* catalogue::TransportCatalogue::GetBusMap() const {
@@ -96,6 +162,37 @@ const std::deque<Bus>* catalogue::TransportCatalogue::GetBuses() const {
 	return &buses_;
 }
 
+instrumentation::MemoryBreakdown TransportCatalogue::MemoryUsage() const {
+	using instrumentation::GetHeapMemory;
+
+	instrumentation::MemoryBreakdown usage;
+	usage.Add("names_arena", names_.MemoryUsage());
+	usage.Add("stop_sequences_arena", stop_sequences_.MemoryUsage());
+	usage.Add("stops", GetHeapMemory(stops_));
+	usage.Add("stop_names", GetHeapMemory(stopname_to_stop_));
+
+	size_t buses_bytes = GetHeapMemory(buses_);
+	for (const Bus& bus : buses_) {
+		buses_bytes += GetHeapMemory(bus.departures);
+	}
+	usage.Add("buses", buses_bytes);
+	usage.Add("bus_names", GetHeapMemory(busname_to_bus_));
+
+	usage.Add("sorted_buses", GetHeapMemory(sorted_buses_));
+	usage.Add("sorted_served_stops", GetHeapMemory(sorted_served_stops_));
+	UpdateStopBuses();
+	{
+		std::lock_guard lock(stop_buses_mutex_);
+		usage.Add("stop_buses", GetHeapMemory(stop_bus_offsets_) + GetHeapMemory(stop_buses_));
+	}
+	usage.Add("distances", GetHeapMemory(pair_stop_to_distance_));
+	return usage;
+}
+
+uint64_t TransportCatalogue::GetVersion() const {
+	return version_;
+}
+
 int TransportCatalogue::GetDistance(StopPtr stop_from, StopPtr stop_to) const {
 	if (pair_stop_to_distance_.count({ stop_from, stop_to })) {
 		return pair_stop_to_distance_.at({ stop_from, stop_to });
@@ -1,5 +1,8 @@
 #pragma once
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
@@ -8,8 +11,11 @@
 #include <deque>
 #include <vector>
 
+#include "arena.h"
 #include "geo.h"
 #include "domain.h"
+#include "memory_usage.h"
+#include "ranges.h"
 
 
 namespace catalogue {
@@ -31,23 +37,54 @@ namespace catalogue {
 		}
 	};
 
+	struct bus_name_less {
+		bool operator()(BusPtr lhs, BusPtr rhs) const {
+			return lhs->bus_name < rhs->bus_name;
+		}
+	};
+
+	struct stop_name_less {
+		bool operator()(StopPtr lhs, StopPtr rhs) const {
+			return lhs->stop_name < rhs->stop_name;
+		}
+	};
+
+	using SortedBuses = std::set<BusPtr, bus_name_less>;
+	using SortedStops = std::set<StopPtr, stop_name_less>;
+	using BusesRange = ranges::Range<std::vector<BusPtr>::const_iterator>;
+
 	class TransportCatalogue {
 	public:
 		void AddStop(const std::string& stop_name, const detail::Coordinates& coordinates);
 		void AddDistance(StopPtr stop_from, StopPtr stop_to, int distance);
-		void AddBus(const std::string& bus_name, const std::vector<StopPtr> stops, bool is_roundtrip);
+		void AddBus(const std::string& bus_name, const std::vector<StopPtr> stops, bool is_roundtrip, double headway = 0., double velocity = 0.,
+			std::vector<double> departures = {});
 		BusStat RequestBus(std::string_view bus_name) const;
-		const std::unordered_set<BusPtr>* RequestStop(StopPtr stop) const;
+		// Маршруты через остановку, отсортированные по названию. Пустой диапазон, если маршрутов нет
+		BusesRange RequestStop(StopPtr stop) const;
+		// Строит индекс маршрутов через остановки, если справочник изменился после его построения.
+		// Вызывается после загрузки; RequestStop и MemoryUsage при необходимости строят его сами
+		void UpdateStopBuses() const;
 		StopPtr GetStop(std::string_view stop_name) const;
 		BusPtr GetBus(std::string_view bus_name) const;
-		const std::unordered_map<StopPtr, std::unordered_set<BusPtr>>* GetBusesByStop() const;
+		// Все маршруты и остановки, через которые проходит хотя бы один маршрут, в порядке названий
+		const SortedBuses* GetSortedBuses() const;
+		const SortedStops* GetSortedServedStops() const;
 		const BusMap* GetBusMap() const;
 		const StopMap* GetStopMap() const;
 		const std::deque<Stop>* GetStops() const;
 		const std::deque<Bus>* GetBuses() const;
 		int GetDistance(StopPtr stop_from, StopPtr stop_to) const;
+		// Номер версии данных, меняется при каждом добавлении остановки, расстояния или маршрута
+		uint64_t GetVersion() const;
+		// Память, занятая справочником, по структурам
+		instrumentation::MemoryBreakdown MemoryUsage() const;
 
 	private:
+		// названия остановок и маршрутов, последовательности остановок маршрутов подряд
+		Arena names_;
+		Arena stop_sequences_;
+
 		// deque всех остановок
 		std::deque<Stop> stops_;
 		// мапа [название остановки] = указатель на остановку
@@ -57,8 +94,22 @@ namespace catalogue {
 		// мапа [название маршрута] = указатель на маршрут в деке
 		BusMap busname_to_bus_;
 
-		std::unordered_map<StopPtr, std::unordered_set<BusPtr>> bus_by_stop_;
+		// порядок вывода для карты, пополняется при добавлении маршрутов
+		SortedBuses sorted_buses_;
+		SortedStops sorted_served_stops_;
+
+		// Маршруты через остановки в формате CSR: маршруты остановки с номером i лежат
+		// в [stop_bus_offsets_[i], stop_bus_offsets_[i + 1]) массива stop_buses_, по названию.
+		// Строится UpdateStopBuses после загрузки или при первом запросе после изменения справочника
+		void BuildStopBuses() const;
+		mutable std::vector<uint32_t> stop_bus_offsets_;
+		mutable std::vector<BusPtr> stop_buses_;
+		mutable std::mutex stop_buses_mutex_;
+		// версия справочника, для которой построен индекс
+		mutable std::atomic<uint64_t> stop_buses_version_ = UINT64_MAX;
 
 		std::unordered_map<std::pair<StopPtr, StopPtr>, int, pair_stops_hasher> pair_stop_to_distance_;
+
+		uint64_t version_ = 0;
 	};
 }
@@ -1,27 +1,354 @@
 #include "transport_router.h"
 
+#include "instrumentation.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+namespace {
+	// Элементы последнего маршрута, найденного FindRoute в этом потоке
+	std::vector<RouteWeight>& GetThreadRouteItems() {
+		thread_local std::vector<RouteWeight> route_items;
+		return route_items;
+	}
+}
+
 TransportRouter::TransportRouter(const catalogue::TransportCatalogue& catalogue, const RouteSettings& settings)
-	: settings_(settings), graph_(2 * catalogue.GetStops()->size()) {
-	
+	: catalogue_(&catalogue), settings_(settings), graph_(2 * catalogue.GetStops()->size()), route_cache_(settings.route_cache_size) {
+	TC_SCOPED_TIMER("TransportRouter::TransportRouter");
+	// число рёбер известно заранее: ожидание на каждой остановке и по ребру на каждую пару остановок маршрута
+	size_t edge_count = catalogue.GetStops()->size();
+	for (const Bus& bus : *catalogue.GetBuses()) {
+		const size_t pairs_count = bus.stops.size() * (bus.stops.size() - 1) / 2;
+		edge_count += bus.is_roundtrip ? pairs_count : 2 * pairs_count;
+	}
+	graph_.ReserveEdges(edge_count);
+	edge_infos_.reserve(edge_count);
+
 	SetStopsGraph(catalogue);
 	SetBusesGraph(catalogue);
+	TC_COUNTER_ADD("graph.vertices", graph_.GetVertexCount());
+	TC_COUNTER_ADD("graph.edges", graph_.GetEdgeCount());
+
+	router_ptr_ = std::make_unique<Router<RouteTime>>(Router(graph_));
+	stops_index_ = catalogue::StopsIndex(*catalogue.GetStops());
+}
+
+instrumentation::MemoryBreakdown TransportRouter::MemoryUsage() const {
+	instrumentation::MemoryBreakdown usage;
+	usage.Add("stop_name_to_id", instrumentation::GetHeapMemory(stop_name_to_id_));
+	usage.Add("stops_by_id", instrumentation::GetHeapMemory(stops_by_id_));
+	usage.Add("stops_index", stops_index_.MemoryUsage());
+	usage.Add("graph", graph_.MemoryUsage());
+	usage.Add("edge_infos", instrumentation::GetHeapMemory(edge_infos_));
+	usage.Add("bus_edge_infos", instrumentation::GetHeapMemory(bus_edge_infos_));
+	usage.Add("router", router_ptr_->MemoryUsage());
+	usage.Add("route_cache", route_cache_.MemoryUsage());
+	return usage;
+}
+
+RouteCache::Stats TransportRouter::GetRouteCacheStats() const {
+	return route_cache_.GetStats();
+}
 
-	router_ptr_ = std::make_unique<Router<RouteWeight>>(Router(graph_));
+std::optional<std::pair<Router<RouteTime>::RouteInfo, std::vector<RouteWeight>>> TransportRouter::BuildRoute(std::string_view from, std::string_view to) const {
+	QueryWorkspace<RouteTime>& workspace = QueryWorkspace<RouteTime>::ForCurrentThread();
+	const std::optional<RouteView> route = FindRoute(from, to, workspace);
+
+	if (route.has_value()) {
+		Router<RouteTime>::RouteInfo route_info{ route->total_time, workspace.GetEdges() };
+		return std::make_pair(std::move(route_info), GetThreadRouteItems());
+	}
+
+	return std::nullopt;
+}
+
+std::optional<RouteView> TransportRouter::FindRoute(std::string_view from, std::string_view to, QueryWorkspace<RouteTime>& workspace) const {
+	const VertexId vertex_from = stop_name_to_id_.at(from).input_id;
+	const VertexId vertex_to = stop_name_to_id_.at(to).input_id;
+
+	// с таблицей всех пар маршрут и так восстанавливается без поиска, кэш нужен только поиску по графу
+	const bool use_cache = route_cache_.IsEnabled() && !router_ptr_->IsPrecomputed();
+	std::optional<RouteTime> time;
+	if (!use_cache || !route_cache_.Find(vertex_from, vertex_to, catalogue_->GetVersion(), time, workspace.GetEdges())) {
+		time = router_ptr_->BuildRoute(vertex_from, vertex_to, workspace);
+		if (use_cache) {
+			route_cache_.Insert(vertex_from, vertex_to, catalogue_->GetVersion(), time, workspace.GetEdges());
+		}
+	}
+
+	return MakeRouteView(time, workspace.GetEdges());
 }
 
-std::optional<std::pair<Router<RouteWeight>::RouteInfo, std::vector<RouteWeight>>> TransportRouter::BuildRoute(std::string_view from, std::string_view to) const {
+void TransportRouter::FindRoutes(std::string_view from, const std::vector<std::string_view>& to,
+	const std::function<void(size_t, const std::optional<RouteView>&)>& callback) const {
+	QueryWorkspace<RouteTime>& workspace = QueryWorkspace<RouteTime>::ForCurrentThread();
+	if (router_ptr_->IsPrecomputed()) {
+		for (size_t i = 0; i < to.size(); ++i) {
+			callback(i, FindRoute(from, to[i], workspace));
+		}
+		return;
+	}
+
+	const VertexId vertex_from = stop_name_to_id_.at(from).input_id;
+	const uint64_t version = catalogue_->GetVersion();
+	// дерево строится при первом промахе кэша; рёбра из кэша пишутся в буфер результата и дерево не портят
+	bool tree_built = false;
+	for (size_t i = 0; i < to.size(); ++i) {
+		const VertexId vertex_to = stop_name_to_id_.at(to[i]).input_id;
+		std::optional<RouteTime> time;
+		if (!route_cache_.IsEnabled() || !route_cache_.Find(vertex_from, vertex_to, version, time, workspace.GetEdges())) {
+			if (!tree_built) {
+				router_ptr_->BuildShortestPathTree(vertex_from, workspace);
+				tree_built = true;
+			}
+			time = router_ptr_->BuildRouteFromTree(vertex_to, workspace);
+			if (route_cache_.IsEnabled()) {
+				route_cache_.Insert(vertex_from, vertex_to, version, time, workspace.GetEdges());
+			}
+		}
+		callback(i, MakeRouteView(time, workspace.GetEdges()));
+	}
+}
+
+std::optional<std::pair<Router<RouteTime>::RouteInfo, std::vector<RouteWeight>>> TransportRouter::BuildRoute(const RoutePoint& from, const RoutePoint& to) const {
+	const bool walk_from = std::holds_alternative<catalogue::detail::Coordinates>(from);
+	const bool walk_to = std::holds_alternative<catalogue::detail::Coordinates>(to);
+	const std::vector<std::pair<VertexId, double>> access_from = GetAccessVertices(from);
+	const std::vector<std::pair<VertexId, double>> access_to = GetAccessVertices(to);
+
+	// между двумя координатами можно дойти пешком напрямую
+	std::optional<double> best_time;
+	if (walk_from && walk_to) {
+		best_time = GetWalkTime(catalogue::detail::ComputeDistance(std::get<catalogue::detail::Coordinates>(from), std::get<catalogue::detail::Coordinates>(to)));
+	}
+	const std::pair<VertexId, double>* best_from = nullptr;
+	const std::pair<VertexId, double>* best_to = nullptr;
+	std::vector<EdgeId> edges;
+
+	if (router_ptr_->IsPrecomputed()) {
+		// по таблице всех пар каждая пара ближайших остановок проверяется за O(1)
+		for (const auto& vertex_from : access_from) {
+			for (const auto& vertex_to : access_to) {
+				const std::optional<RouteTime> weight = router_ptr_->GetRouteWeight(vertex_from.first, vertex_to.first);
+				if (!weight) {
+					continue;
+				}
+				const double total_time = vertex_from.second + *weight + vertex_to.second;
+				if (!best_time || total_time < *best_time) {
+					best_time = total_time;
+					best_from = &vertex_from;
+					best_to = &vertex_to;
+				}
+			}
+		}
+		if (best_from != nullptr) {
+			edges = router_ptr_->BuildRoute(best_from->first, best_to->first)->edges;
+		}
+	}
+	else {
+		// один поиск от всех начальных остановок сразу, с временем пешком до них как начальным весом
+		QueryWorkspace<RouteTime>& workspace = QueryWorkspace<RouteTime>::ForCurrentThread();
+		std::vector<VertexId> targets;
+		for (const auto& vertex_to : access_to) {
+			targets.push_back(vertex_to.first);
+		}
+		router_ptr_->BuildShortestPathTree(access_from, targets, workspace);
+
+		for (const auto& vertex_to : access_to) {
+			if (!workspace.IsSettled(vertex_to.first)) {
+				continue;
+			}
+			const double total_time = workspace.GetWeight(vertex_to.first) + vertex_to.second;
+			if (!best_time || total_time < *best_time) {
+				best_time = total_time;
+				best_to = &vertex_to;
+			}
+		}
+		if (best_to != nullptr) {
+			router_ptr_->BuildRouteFromTree(best_to->first, workspace);
+			edges = workspace.GetEdges();
+			// путь начинается в той начальной остановке, до которой дерево дошло без рёбер
+			const VertexId start = edges.empty() ? best_to->first : graph_.GetEdge(edges.front()).from;
+			for (const auto& vertex_from : access_from) {
+				if (vertex_from.first == start && (best_from == nullptr || vertex_from.second < best_from->second)) {
+					best_from = &vertex_from;
+				}
+			}
+		}
+	}
+
+	if (!best_time) {
+		return std::nullopt;
+	}
+
+	Router<RouteTime>::RouteInfo route_info{ *best_time, {} };
 	std::vector<RouteWeight> route_items;
-	std::optional<Router<RouteWeight>::RouteInfo> route_info = router_ptr_.get()->BuildRoute(stop_name_to_id_.at(from).input_id, stop_name_to_id_.at(to).input_id);
 
-	if (route_info.has_value()) {
-		for (size_t egde_id : route_info.value().edges) {
-			route_items.emplace_back(graph_.GetEdge(egde_id).weight);
+	if (best_from == nullptr) {
+		route_items.push_back({ false, {}, *best_time, 0, true });
+		return std::make_pair(std::move(route_info), std::move(route_items));
+	}
+
+	// пеший участок есть только у конца, заданного координатами
+	if (walk_from) {
+		route_items.push_back({ false, stops_by_id_[best_from->first / 2]->stop_name, best_from->second, 0, true });
+	}
+	AppendRouteItems(edges, route_items);
+	if (walk_to) {
+		route_items.push_back({ false, stops_by_id_[best_to->first / 2]->stop_name, best_to->second, 0, true });
+	}
+	route_info.edges = std::move(edges);
+
+	return std::make_pair(std::move(route_info), std::move(route_items));
+}
+
+std::optional<std::vector<std::optional<double>>> TransportRouter::BuildTimeMatrix(const std::vector<RoutePoint>& from, const std::vector<RoutePoint>& to) const {
+	const auto is_known = [this](const RoutePoint& point) {
+		return IsKnownPoint(point);
+	};
+	if (!std::all_of(from.begin(), from.end(), is_known) || !std::all_of(to.begin(), to.end(), is_known)) {
+		return std::nullopt;
+	}
+	std::vector<std::optional<double>> result(from.size() * to.size());
+
+	std::vector<std::vector<std::pair<VertexId, double>>> access_to;
+	size_t access_to_count = 0;
+	for (const RoutePoint& point : to) {
+		access_to.emplace_back(GetAccessVertices(point));
+		access_to_count += access_to.back().size();
+	}
+
+	const auto compute_row = [&](size_t row) {
+		const std::vector<std::pair<VertexId, double>> access_from = GetAccessVertices(from[row]);
+
+		// без таблицы всех пар один поиск от точки from даёт сразу всю строку
+		QueryWorkspace<RouteTime>& workspace = QueryWorkspace<RouteTime>::ForCurrentThread();
+		if (!router_ptr_->IsPrecomputed()) {
+			router_ptr_->ForEachReachable(access_from, std::numeric_limits<double>::infinity(), [](VertexId, RouteTime) {}, workspace);
+		}
+
+		for (size_t col = 0; col < to.size(); ++col) {
+			std::optional<double>& cell = result[row * to.size() + col];
+
+			// между двумя координатами можно дойти пешком
+			if (std::holds_alternative<catalogue::detail::Coordinates>(from[row]) && std::holds_alternative<catalogue::detail::Coordinates>(to[col])) {
+				cell = GetWalkTime(catalogue::detail::ComputeDistance(std::get<catalogue::detail::Coordinates>(from[row]), std::get<catalogue::detail::Coordinates>(to[col])));
+			}
+			if (!router_ptr_->IsPrecomputed()) {
+				for (const auto& [vertex_to, time_to] : access_to[col]) {
+					if (workspace.IsSettled(vertex_to) && (!cell || workspace.GetWeight(vertex_to) + time_to < *cell)) {
+						cell = workspace.GetWeight(vertex_to) + time_to;
+					}
+				}
+				continue;
+			}
+			for (const auto& [vertex_from, time_from] : access_from) {
+				for (const auto& [vertex_to, time_to] : access_to[col]) {
+					const std::optional<RouteTime> weight = router_ptr_->GetRouteWeight(vertex_from, vertex_to);
+					if (weight && (!cell || time_from + *weight + time_to < *cell)) {
+						cell = time_from + *weight + time_to;
+					}
+				}
+			}
 		}
+	};
 
-		return std::make_pair(route_info.value(), route_items);
+	const size_t threads_count = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), from.size());
+	if (threads_count <= 1 || from.size() * access_to_count * settings_.walking_stops_count < PARALLEL_MATRIX_THRESHOLD) {
+		for (size_t row = 0; row < from.size(); ++row) {
+			compute_row(row);
+		}
+		return result;
 	}
 
-	return std::nullopt;
+	// каждый поток пишет только в свои строки, синхронизация не нужна
+	std::vector<std::thread> threads;
+	for (size_t thread_id = 0; thread_id < threads_count; ++thread_id) {
+		threads.emplace_back([&compute_row, &from, thread_id, threads_count]() {
+			for (size_t row = thread_id; row < from.size(); row += threads_count) {
+				compute_row(row);
+			}
+			});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	return result;
+}
+
+std::optional<std::vector<std::pair<StopPtr, double>>> TransportRouter::BuildIsochrone(const RoutePoint& from, double max_time) const {
+	if (!IsKnownPoint(from)) {
+		return std::nullopt;
+	}
+	std::vector<std::pair<StopPtr, double>> result;
+
+	// на остановку прибываем во входную вершину, выходные вершины - это уже ожидание автобуса
+	router_ptr_->ForEachReachable(GetAccessVertices(from), max_time, [this, &result](VertexId vertex, RouteTime time) {
+		if (vertex % 2 == 0) {
+			result.emplace_back(stops_by_id_[vertex / 2], time);
+		}
+		});
+	return result;
+}
+
+bool TransportRouter::IsKnownPoint(const RoutePoint& point) const {
+	return !std::holds_alternative<std::string_view>(point) || stop_name_to_id_.count(std::get<std::string_view>(point));
+}
+
+std::vector<std::pair<VertexId, double>> TransportRouter::GetAccessVertices(const RoutePoint& point) const {
+	std::vector<std::pair<VertexId, double>> result;
+
+	if (std::holds_alternative<std::string_view>(point)) {
+		const auto it = stop_name_to_id_.find(std::get<std::string_view>(point));
+		if (it != stop_name_to_id_.end()) {
+			result.emplace_back(it->second.input_id, 0.);
+		}
+		return result;
+	}
+
+	for (const auto& [stop, distance] : stops_index_.FindNearest(std::get<catalogue::detail::Coordinates>(point), settings_.walking_stops_count)) {
+		result.emplace_back(stop_name_to_id_.at(stop->stop_name).input_id, GetWalkTime(distance));
+	}
+	return result;
+}
+
+std::optional<RouteView> TransportRouter::MakeRouteView(std::optional<RouteTime> time, const std::vector<EdgeId>& edges) const {
+	std::vector<RouteWeight>& route_items = GetThreadRouteItems();
+	route_items.clear();
+	if (!time.has_value()) {
+		return std::nullopt;
+	}
+	AppendRouteItems(edges, route_items);
+
+	return RouteView{ *time, ranges::AsRange(route_items) };
+}
+
+void TransportRouter::AppendRouteItems(const std::vector<EdgeId>& edges, std::vector<RouteWeight>& route_items) const {
+	for (EdgeId edge_id : edges) {
+		const Edge<RouteTime>& edge = graph_.GetEdge(edge_id);
+		const std::string_view stop_name = stops_by_id_[edge.from / 2]->stop_name;
+		if (edge_infos_[edge_id] == WAIT_EDGE_INFO) {
+			route_items.push_back({ true, stop_name, edge.weight, 0 });
+			continue;
+		}
+
+		const BusEdgeInfo& info = bus_edge_infos_[edge_infos_[edge_id]];
+		const double wait_time = GetBusWaitTime(*info.bus);
+		if (wait_time > 0) {
+			route_items.push_back({ true, stop_name, wait_time, 0 });
+		}
+		route_items.push_back({ false, info.bus->bus_name, edge.weight - wait_time, info.span_count });
+	}
+}
+
+double TransportRouter::GetWalkTime(double distance) const {
+	return distance / (settings_.walking_velocity * TRANSLATE_TO_M_MIN);
+}
+
+double TransportRouter::GetBusWaitTime(const Bus& bus) const {
+	return bus.headway > 0 ? bus.headway / 2 : 0.;
 }
 
 void TransportRouter::SetStopsGraph(const catalogue::TransportCatalogue& catalogue) {
@@ -29,7 +356,9 @@ void TransportRouter::SetStopsGraph(const catalogue::TransportCatalogue& catalog
 
 	for (const Stop& stop : *catalogue.GetStops()) {
 		stop_name_to_id_.insert({ stop.stop_name, stop_id });
-		graph_.AddEdge({ stop_id.input_id, stop_id.output_id, { true, stop.stop_name , settings_.bus_wait_time, 0} });
+		stops_by_id_.push_back(&stop);
+		graph_.AddEdge({ stop_id.input_id, stop_id.output_id, settings_.bus_wait_time });
+		edge_infos_.push_back(WAIT_EDGE_INFO);
 
 		stop_id.input_id += 2;
 		stop_id.output_id += 2;
@@ -39,6 +368,23 @@ void TransportRouter::SetStopsGraph(const catalogue::TransportCatalogue& catalog
 void TransportRouter::SetBusesGraph(const catalogue::TransportCatalogue& catalogue) {
 
 	for (const Bus& bus : *catalogue.GetBuses()) {
+		const double velocity = bus.velocity > 0 ? bus.velocity : settings_.bus_velocity;
+		// у маршрута со своим интервалом ожидание (половина интервала) входит в само ребро,
+		// которое поэтому начинается во входной вершине остановки, минуя общее ожидание bus_wait_time
+		const double wait_time = GetBusWaitTime(bus);
+		// рёбра маршрута с одинаковым числом перегонов различаются только временем и концами,
+		// поэтому описание span_count перегонов заводится один раз на маршрут
+		const size_t infos_offset = bus_edge_infos_.size();
+		for (size_t span_count = 1; span_count < bus.stops.size(); ++span_count) {
+			bus_edge_infos_.push_back({ &bus, static_cast<int>(span_count) });
+		}
+		const auto add_bus_edge = [&](StopPtr stop_from, StopPtr stop_to, double distance, int span_count) {
+			const StopId& from_id = stop_name_to_id_.at(stop_from->stop_name);
+			const double route_time = wait_time + distance / (velocity * TRANSLATE_TO_M_MIN);
+			graph_.AddEdge({ wait_time > 0 ? from_id.input_id : from_id.output_id, stop_name_to_id_.at(stop_to->stop_name).input_id, route_time });
+			edge_infos_.push_back(static_cast<uint32_t>(infos_offset + span_count - 1));
+		};
+
 		if (bus.is_roundtrip) {
 			for (size_t i = 0; i < bus.stops.size() - 1; ++i) {
 
@@ -49,13 +395,12 @@ void TransportRouter::SetBusesGraph(const catalogue::TransportCatalogue& catalog
 				for (size_t j = i + 1; j < bus.stops.size(); ++j) {
 					StopPtr iter_stop = bus.stops[j];
 					distance += static_cast<double>(catalogue.GetDistance(bus.stops[j - 1], iter_stop));
-					double route_time = distance / (settings_.bus_velocity * TRANSLATE_TO_M_MIN);
-					graph_.AddEdge({ stop_name_to_id_.at(curr_stop->stop_name).output_id, stop_name_to_id_.at(iter_stop->stop_name).input_id, { false, bus.bus_name, route_time, ++span_count} });
+					add_bus_edge(curr_stop, iter_stop, distance, ++span_count);
 				}
 			}
 		}
 		else {
-			for (size_t i = 0; i < (bus.stops.size() - 1) / 2; ++i) {
+			for (size_t i = 0; i + 1 < bus.stops.size(); ++i) {
 				StopPtr curr_stop = bus.stops[i];
 
 				double distance_forward = 0;
@@ -63,17 +408,14 @@ void TransportRouter::SetBusesGraph(const catalogue::TransportCatalogue& catalog
 				int span_count_forward = 0;
 				int span_count_backward = 0;
 
-				for (size_t j = i + 1; j < (bus.stops.size() + 1) / 2; ++j) {
+				for (size_t j = i + 1; j < bus.stops.size(); ++j) {
 					StopPtr iter_stop = bus.stops[j];
 
 					distance_forward += static_cast<double>(catalogue.GetDistance(bus.stops[j - 1], iter_stop));
 					distance_backward += static_cast<double>(catalogue.GetDistance(iter_stop, bus.stops[j - 1]));
-					
-					double route_time_forward = distance_forward / (settings_.bus_velocity * TRANSLATE_TO_M_MIN);
-					double route_time_backward = distance_backward / (settings_.bus_velocity * TRANSLATE_TO_M_MIN);
 
-					graph_.AddEdge({ stop_name_to_id_.at(curr_stop->stop_name).output_id, stop_name_to_id_.at(iter_stop->stop_name).input_id, { false, bus.bus_name, route_time_forward, ++span_count_forward} });
-					graph_.AddEdge({ stop_name_to_id_.at(iter_stop->stop_name).output_id, stop_name_to_id_.at(curr_stop->stop_name).input_id, { false, bus.bus_name, route_time_backward, ++span_count_backward} });
+					add_bus_edge(curr_stop, iter_stop, distance_forward, ++span_count_forward);
+					add_bus_edge(iter_stop, curr_stop, distance_backward, ++span_count_backward);
 				}
 			}
 		}
@@ -1,51 +1,130 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include <string_view>
 #include <memory>
 #include <unordered_map>
 #include <optional>
+#include <variant>
+#include <vector>
 
 #include "domain.h"
 #include "graph.h"
+#include "memory_usage.h"
+#include "query_workspace.h"
+#include "ranges.h"
+#include "route_cache.h"
 #include "router.h"
+#include "stops_index.h"
 #include "transport_catalogue.h"
 
 using namespace graph;
 
+// Элемент маршрута в ответе. В граф не входит: у рёбер графа вес - только время RouteTime,
+// а элементы восстанавливаются по описаниям рёбер при выводе найденного пути
 struct RouteWeight {
 	bool is_stop = true;
 	std::string_view name;
 	double route_time = 0.0;
 	int span_count = 0;
+	// пеший участок до остановки name (или от неё), в граф не входит
+	bool is_walk = false;
+};
 
-	bool operator<(const RouteWeight& other) const {
-		return route_time < other.route_time;
-	}
+// Вес ребра графа маршрутов: время в минутах
+using RouteTime = double;
 
-	bool operator>(const RouteWeight& other) const {
-		return route_time > other.route_time;
-	}
+// Точка маршрута: название остановки или произвольные координаты
+using RoutePoint = std::variant<std::string_view, catalogue::detail::Coordinates>;
 
-	RouteWeight operator+(const RouteWeight& other) const {
-		return { is_stop, name, route_time + other.route_time, span_count };
-	}
+// Маршрут, собранный в буферах рабочего пространства потока.
+// Действителен до следующего запроса к маршрутизатору в этом же потоке
+struct RouteView {
+	double total_time = 0.;
+	ranges::Range<std::vector<RouteWeight>::const_iterator> items;
 };
 
 class TransportRouter {
 public:
 	TransportRouter(const catalogue::TransportCatalogue& catalogue, const RouteSettings& settings);
 
-	std::optional<std::pair<Router<RouteWeight>::RouteInfo, std::vector<RouteWeight>>> BuildRoute(std::string_view from, std::string_view to) const;
+	std::optional<std::pair<Router<RouteTime>::RouteInfo, std::vector<RouteWeight>>> BuildRoute(std::string_view from, std::string_view to) const;
+
+	// Маршрут между остановками без выделения памяти: рёбра пишутся в буфер workspace, элементы маршрута - в буфер потока.
+	// Найденные поиском по графу маршруты запоминаются в кэше
+	std::optional<RouteView> FindRoute(std::string_view from, std::string_view to,
+		QueryWorkspace<RouteTime>& workspace = QueryWorkspace<RouteTime>::ForCurrentThread()) const;
+
+	// Маршруты от остановки from до каждой из остановок to: callback(i, route) вызывается для to[i] по порядку,
+	// route действителен только внутри вызова. Маршруты, которых нет в кэше, восстанавливаются
+	// по одному дереву кратчайших путей от from вместо отдельного поиска для каждой пары
+	void FindRoutes(std::string_view from, const std::vector<std::string_view>& to,
+		const std::function<void(size_t, const std::optional<RouteView>&)>& callback) const;
+
+	// Маршрут между произвольными точками: от координат пешком до одной из ближайших остановок, по графу
+	// и пешком до точки; концом маршрута может быть и остановка. Пешие рёбра не добавляются в граф,
+	// а перебираются при запросе, поэтому граф общий для всех запросов. Неизвестная остановка - nullopt
+	std::optional<std::pair<Router<RouteTime>::RouteInfo, std::vector<RouteWeight>>> BuildRoute(const RoutePoint& from, const RoutePoint& to) const;
+
+	// Время в пути от каждой точки from до каждой точки to без восстановления маршрутов.
+	// Матрица хранится по строкам (from.size() x to.size()), недостижимые пары - nullopt.
+	// Строки считаются параллельно. Если среди точек есть неизвестная остановка - nullopt
+	std::optional<std::vector<std::optional<double>>> BuildTimeMatrix(const std::vector<RoutePoint>& from, const std::vector<RoutePoint>& to) const;
+
+	// Все остановки, до которых можно добраться из точки from не дольше чем за max_time минут,
+	// с наименьшим временем прибытия, в порядке его возрастания. Для неизвестной остановки from - nullopt
+	std::optional<std::vector<std::pair<StopPtr, double>>> BuildIsochrone(const RoutePoint& from, double max_time) const;
+
+	// Память маршрутизатора вместе с графом и таблицей путей graph::Router
+	instrumentation::MemoryBreakdown MemoryUsage() const;
+
+	// Попадания и промахи кэша маршрутов между остановками
+	RouteCache::Stats GetRouteCacheStats() const;
 
 private:
 	constexpr static double TRANSLATE_TO_M_MIN = 1000.0 / 60.0;
+	// минимальное число перебираемых пар вершин, при котором матрицу имеет смысл считать в нескольких потоках
+	constexpr static size_t PARALLEL_MATRIX_THRESHOLD = 1 << 14;
+	// описание ребра ожидания на остановке: остановка определяется по вершине ребра
+	constexpr static uint32_t WAIT_EDGE_INFO = UINT32_MAX;
+
+	// Описание ребра автобуса, общее для всех рёбер маршрута bus с одинаковым числом перегонов
+	struct BusEdgeInfo {
+		BusPtr bus = nullptr;
+		int span_count = 0;
+	};
 
 	void SetStopsGraph(const catalogue::TransportCatalogue& catalogue);
 	void SetBusesGraph(const catalogue::TransportCatalogue& catalogue);
 
+	double GetWalkTime(double distance) const;
+	// ожидание, включённое в рёбра маршрута со своим интервалом движения
+	double GetBusWaitTime(const Bus& bus) const;
+
+	// Маршрут по найденному времени и рёбрам пути, элементы собираются в буфере потока
+	std::optional<RouteView> MakeRouteView(std::optional<RouteTime> time, const std::vector<EdgeId>& edges) const;
+
+	// Элементы маршрута по рёбрам графа; ожидание, включённое в ребро автобуса, выносится в отдельный элемент
+	void AppendRouteItems(const std::vector<EdgeId>& edges, std::vector<RouteWeight>& route_items) const;
+
+	// Координаты или остановка из справочника
+	bool IsKnownPoint(const RoutePoint& point) const;
+
+	// Вершины графа, с которых начинается (или которыми заканчивается) путь из точки, и время до них
+	std::vector<std::pair<VertexId, double>> GetAccessVertices(const RoutePoint& point) const;
+
+	// версия справочника проверяется кэшем маршрутов
+	const catalogue::TransportCatalogue* catalogue_ = nullptr;
 	RouteSettings settings_;
 	std::unordered_map<std::string_view, StopId> stop_name_to_id_;
-	DirectedWeightedGraph<RouteWeight> graph_;
-	std::unique_ptr<Router<RouteWeight>> router_ptr_ = nullptr;
+	// остановка по номеру её входной вершины, делённому на 2
+	std::vector<StopPtr> stops_by_id_;
+	DirectedWeightedGraph<RouteTime> graph_;
+	// для каждого ребра графа - номер описания в bus_edge_infos_ или WAIT_EDGE_INFO
+	std::vector<uint32_t> edge_infos_;
+	std::vector<BusEdgeInfo> bus_edge_infos_;
+	std::unique_ptr<Router<RouteTime>> router_ptr_ = nullptr;
+	catalogue::StopsIndex stops_index_;
+	mutable RouteCache route_cache_;
 };